@@ -1,71 +1,204 @@
 #version 330 core
+#extension GL_ARB_shader_image_load_store : enable
 
-in vec3 pos_world;
+// Slices write no depth, so the depth test can always run before the
+// shader, and a fragment behind the scene costs no texture fetches.
+// Drivers may not do it on their own because of the discards below.
+#ifdef GL_ARB_shader_image_load_store
+layout(early_fragment_tests) in;
+#endif
 
-uniform float layerDensity;
-uniform vec3 noiseSampleScale;
+#include "cloud_density.glsl"
+
+in vec3 pos_world_slice;
+flat in float sliceDepth;
+// Distance to the next slice in front, which this one stands for
+flat in float sliceSpacing;
+
+// Spacing of the nearest slices
+uniform float sliceDistance;
+
+// If set, samples move towards the camera by a per-pixel fraction of
+// sliceSpacing, offset by frameJitter every frame
+uniform bool jittered = false;
+uniform float frameJitter;
 uniform bool adjustColor = false;
+// Set when slices are blended under the ones in front of them, which needs
+// premultiplied color
+uniform bool premultiplied = false;
+
+// Half-angle slices are shaded by the opacity of the slices between them
+// and the light, looked up in lightBuffer at (lightMatrix * pos).xy.
+// Cloud that no light reaches is cloudAmbient times as bright.
+uniform bool shadowed = false;
+uniform sampler2D lightBuffer;
+uniform mat4 lightMatrix;
+uniform float cloudAmbient;
+
+// Or, with lit set, by the transmittance towards the light precomputed in
+// lightVolume, over the box from lightVolumeOrigin to + lightVolumeSize
+uniform bool lit = false;
+uniform sampler3D lightVolume;
+uniform vec3 lightVolumeOrigin;
+uniform vec3 lightVolumeSize;
 
-uniform float startHeight;
-uniform uint heightTexHeight;
-uniform sampler1D heightTex;
 uniform sampler1D heightGradTex;
 
-uniform sampler3D noiseTex;
-uniform sampler3D noiseGradTex;
+// Empty space: heights where heightTex can be nonzero, and the range of
+// noiseTex in each brick (.r minimum, .g maximum), valid for mips up to
+// occupancyMaxLod of a noiseResolution^3 texture
+uniform vec2 heightOccupied;
+uniform sampler3D occupancyTex;
+uniform float occupancyMaxLod;
+uniform float noiseResolution;
+
+// The gradient of the shape's density, stored in noiseTex's rgb as
+// (gradient - noiseGradBias) / noiseGradScale
+uniform float noiseGradScale;
+uniform float noiseGradBias;
+// Detail, stored as noiseTex is, repeated detailRepeat times across
+// noiseTex, and added to the shape's density in full where that is at least
+// detailFade
+uniform sampler3D detailTex;
+uniform float detailGradScale;
+uniform float detailGradBias;
+uniform float detailRepeat;
+uniform float detailFade;
+uniform vec3 cloudColor;
 
 uniform vec3 cameraPos;
 uniform vec3 lightDir; // unused
 
 out vec4 color;
 
-void main() {
-    float h = pos_world.y;
-
-    vec3 adjPos = vec3(pos_world.x, h, pos_world.z);
-
-    // Sample cloud density texture
-    vec4 noiseSample = texture(noiseTex, adjPos / noiseSampleScale);
-
-    vec3 sampleColor = noiseSample.xyz;
-    float density = noiseSample.a;
-
-    /// Cloud geometry
+// Interleaved gradient noise (Jimenez 2014): a per-pixel value in [0, 1)
+// whose neighbours differ, so shifted slices show fine noise, not bands
+float pixelNoise(vec2 pixel) {
+    return fract(52.9829189 * fract(dot(pixel, vec2(0.06711056, 0.00583715))));
+}
 
-    // Cut off clouds below horizon
-    density *= smoothstep(startHeight, startHeight + 2, pos_world.y);
-    // Add curve
-    float curve = -startHeight + pow(length(pos_world.xz) / 20, 2);
-    h += curve;
-    // Limit clouds to a reasonable area
-    density *= step(0, h) - step(heightTexHeight, h);
+// A texel of the shape, with its gradient decoded, blended between the
+// sparse volume and the tiling noise as sampleShape blends its density
+vec4 sampleShape(vec3 coord, vec3 coordDx, vec3 coordDy) {
+    float weight = sparse ? brickWeight(coord) : 0.0;
+    vec4 texel = vec4(0);
+    if (weight > 0) {
+        vec4 brick = findBrick(coord);
+        if (brick.w == 2) {
+            vec3 scale = sparseResolution / atlasSize;
+            texel = textureGrad(brickAtlas, brick.xyz, coordDx * scale, coordDy * scale);
+        }
+    }
+    if (weight < 1) {
+        vec4 tiled = textureGrad(noiseTex, coord, coordDx, coordDy);
+        tiled.rgb = tiled.rgb * noiseGradScale + noiseGradBias;
+        texel = mix(tiled, texel, weight);
+    }
+    return texel;
+}
 
-    if (density < 0) discard;
+// The shape, its density faded as shapeDensity fades it. The gradient stays
+// the unfaded shape's.
+vec4 fetchShape(vec3 coord, vec3 coordDx, vec3 coordDy) {
+    vec4 texel = sampleShape(coord, coordDx, coordDy);
+    if (noiseBlend > 0) {
+        float faded = sparse ? sampleShape(coord + 0.5, coordDx, coordDy).a
+                             : textureGrad(noiseFadeTex, coord, coordDx, coordDy).r;
+        texel.a = mix(texel.a, faded, noiseBlend);
+    }
+    return texel;
+}
 
-    // Sample height density texture
-    float heightDensity = texture(heightTex, h / heightTexHeight)[0];
-    density *= heightDensity;
+vec3 samplePosition() {
+    if (!jittered || sliceDepth <= 0) return pos_world_slice;
+    float offset = fract(pixelNoise(gl_FragCoord.xy) + frameJitter) * sliceSpacing;
+    // Towards the camera, so samples stay in front of the scene
+    return mix(cameraPos, pos_world_slice, max(0, 1 - offset / sliceDepth));
+}
 
-    if (density < 0) discard;
+void main() {
+    vec3 pos_world = samplePosition();
+    vec3 coord = noiseCoord(pos_world);
+
+    // Derivatives for the noise's mip level. They come from the unshifted
+    // slice, since per-pixel shifts would make them large, and are taken
+    // before anything is discarded.
+    vec3 noiseCoordDx = dFdx(pos_world_slice) / noiseSampleScale;
+    vec3 noiseCoordDy = dFdy(pos_world_slice) / noiseSampleScale;
+    float footprint = noiseResolution * max(length(noiseCoordDx), length(noiseCoordDy));
+
+    // Slices further apart than the nearest ones skip over more of the
+    // noise along the view. Blur it over the extra distance by sampling a
+    // coarser mip.
+    vec3 extraStep = normalize(pos_world_slice - cameraPos)
+            * (sliceSpacing - sliceDistance) / noiseSampleScale;
+    float minFootprint = noiseResolution * length(extraStep);
+    if (minFootprint > 1 && footprint < minFootprint) {
+        float scale = minFootprint / max(footprint, 1e-6);
+        noiseCoordDx *= scale;
+        noiseCoordDy *= scale;
+        footprint = minFootprint;
+    }
 
-    // Give clouds a harder edge
-    density = 0.5 * smoothstep(0, 0.1, density);
+    // Skip empty space: below the horizon cutoff, at heights (after the
+    // layer's curve) where the height texture is zero, and in bricks of
+    // noise that are nowhere positive. The bricks only bound the noise's
+    // finer mips, and only the tiling noise; the sparse volume's empty
+    // bricks are skipped as it is sampled.
+    float curvedHeight = layerHeight(pos_world);
+    if (pos_world.y <= startHeight
+            || curvedHeight < heightOccupied.x
+            || curvedHeight > heightOccupied.y) discard;
+    // The coverage map is a 2D lookup, so it goes first: skip where it
+    // clears the sky, or squashes the layer below this height
+    vec2 cover = coverageAt(pos_world);
+    float squash = heightSquash(cover.y);
+    if (cover.x <= 0
+            || curvedHeight > cloudFloor + (heightOccupied.y - cloudFloor) * squash) discard;
+    if (!sparse && footprint <= exp2(occupancyMaxLod)
+            && texture(occupancyTex, coord).g <= 0) discard;
+
+    // Sample cloud density texture. The detail only shapes cloud that is
+    // there already, so where there is none it is not sampled. The same
+    // texels hold the gradients used below.
+    vec4 shapeTexel = cover.x * fetchShape(coord, noiseCoordDx, noiseCoordDy);
+    float shapeSample = shapeTexel.a;
+    if (shapeSample <= 0) discard;
+    // The detail only modulates the shape and averages out, so it does not
+    // fade
+    vec4 detailTexel = textureGrad(detailTex, coord * detailRepeat,
+                                   noiseCoordDx * detailRepeat,
+                                   noiseCoordDy * detailRepeat);
+    float detailSample = detailTexel.a;
+    float detailWeight = min(shapeSample / detailFade, 1);
+    float noiseSample = shapeSample + detailWeight * detailSample;
+
+    vec3 sampleColor = cloudColor;
+    float density = cloudDensity(noiseSample, pos_world, curvedHeight, cover.y);
+    if (density <= 0) discard;
     // If our volumetric planes are close together, decrease
     // cloud density.
-    density = 1 - pow(1 - density, layerDensity);
+    density = 1 - pow(1 - density, sliceSpacing);
 
     // Disabled by default for high computational cost
     if (adjustColor) {
         // To calculate color, we want to use the gradient of
         // the noise and height textures
-        vec3 noiseGradSample = texture(noiseGradTex, adjPos / noiseSampleScale).xyz
-                / noiseSampleScale;
-        float heightGradSample = texture(heightGradTex, h / heightTexHeight)[0]
-                / heightTexHeight;
+        vec3 shapeGradSample = shapeTexel.rgb / noiseSampleScale;
+        vec3 detailGradSample = (detailTexel.rgb * detailGradScale + detailGradBias)
+                * detailRepeat / noiseSampleScale;
+        // Product rule, where the detail is fading in
+        vec3 noiseGradSample = shapeGradSample + detailWeight * detailGradSample;
+        if (shapeSample < detailFade)
+            noiseGradSample += detailSample / detailFade * shapeGradSample;
+        float profile = profileHeight(curvedHeight, cover.y) / heightTexHeight;
+        float heightDensity = texture(heightTex, profile)[0];
+        float heightGradSample = texture(heightGradTex, profile)[0]
+                / (heightTexHeight * squash);
         // Product rule
         vec3 grad = vec3(
                     noiseGradSample.x,
-                    noiseSample.a * heightGradSample + noiseGradSample.y * heightDensity,
+                    noiseSample * heightGradSample + noiseGradSample.y * heightDensity,
                     noiseGradSample.z);
 
         vec3 vecToCamera = cameraPos - pos_world;
@@ -74,15 +207,22 @@ void main() {
         // Adjust color
 
         /// Adjust light using gradient
-        /// Unfortunately, there seems to be an error in the
-        /// gradient calculations, so none of the following functions
-        /// work very well.
+        /// None of the following functions work very well.
 
         // sampleColor += 5 * length(cross(dirToCamera, grad));
         // sampleColor += 8 * dot(dirToCamera, grad);
         // sampleColor *= max(0.5, 2 - 3 / sqrt(h + 3));
     }
 
+    if (shadowed) {
+        float lightOpacity = texture(lightBuffer, (lightMatrix * vec4(pos_world, 1)).xy).r;
+        sampleColor *= mix(1, cloudAmbient, lightOpacity);
+    } else if (lit) {
+        float lightTransmittance = texture(lightVolume,
+                (pos_world - lightVolumeOrigin) / lightVolumeSize).r;
+        sampleColor *= mix(cloudAmbient, 1, lightTransmittance);
+    }
+
     // Final color
-    color = vec4(sampleColor, density);
+    color = vec4(premultiplied ? sampleColor * density : sampleColor, density);
 }
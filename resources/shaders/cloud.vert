@@ -1,17 +1,59 @@
 #version 330 core
 
-layout(location = 0) in vec3 pos_hybrid;
+// One full-screen slice per instance, made of one quad per screen tile.
+// Instance i is slice farthestSlice - i, so instances go back to front, or
+// with frontToBack set, slice nearestSlice + i.
+// Slices are sliceDistance apart up to slice 1 / sliceGrowth, and from there
+// each is sliceGrowth times its depth further than the one before (see
+// SliceLayout).
+uniform float sliceDistance;
+uniform float sliceGrowth;
+uniform int farthestSlice;
+uniform int nearestSlice;
+uniform bool frontToBack = false;
+
+// Farthest scene depth in each tile. Tiles where the slice is behind that
+// collapse to a point, so they are never rasterized.
+uniform sampler2D tileDepth;
+
+const vec2 corners[6] = vec2[6](
+    vec2( 1,  1), vec2(-1,  1), vec2(-1, -1),
+    vec2( 1,  1), vec2(-1, -1), vec2( 1, -1));
 
 uniform mat4 viewMatrix;
 uniform mat4 invViewMatrix;
 uniform mat4 projMatrix;
 uniform mat4 invProjMatrix;
 
-out vec3 pos_world;
+out vec3 pos_world_slice;
+flat out float sliceDepth;
+flat out float sliceSpacing;
+
+float depthOf(float k) {
+    if (sliceGrowth <= 0 || k * sliceGrowth <= 1) return k * sliceDistance;
+    return sliceDistance / sliceGrowth * pow(1 + sliceGrowth, k - 1 / sliceGrowth);
+}
 
 void main() {
+    ivec2 tiles = textureSize(tileDepth, 0);
+    int tileIndex = gl_VertexID / 6;
+    ivec2 tile = ivec2(tileIndex % tiles.x, tileIndex / tiles.x);
+    vec2 corner = (tile + 0.5 + 0.5 * corners[gl_VertexID % 6]) / tiles * 2 - 1;
+
+    // xy in NDC, z in view space
+    float k = frontToBack ? nearestSlice + gl_InstanceID
+                          : farthestSlice - gl_InstanceID;
+    sliceDepth = depthOf(k);
+    sliceSpacing = sliceDepth - depthOf(k - 1);
+    vec3 pos_hybrid = vec3(corner, -sliceDepth);
     vec4 pos_proj = projMatrix * vec4(pos_hybrid, 1);
 
+    // Depth test this tile as a whole (GL_LESS)
+    if ((pos_proj.z / pos_proj.w) * 0.5 + 0.5 > texelFetch(tileDepth, tile, 0).r) {
+        gl_Position = vec4(0, 0, 0, 1);
+        return;
+    }
+
     pos_proj.xy = pos_hybrid.xy * pos_proj.w;
 //    float xScale = pos_proj.x / pos_proj[3] / pos_hybrid.x;
 //    float yScale = pos_proj.y / pos_proj[3] / pos_hybrid.y;
@@ -21,7 +63,7 @@ void main() {
 //                pos_hybrid.z);
 //    pos_world = (invViewMatrix * vec4(pos_view, 1)).xyz;
     vec4 pos_view = invProjMatrix * pos_proj;
-    pos_world = (invViewMatrix * pos_view).xyz;
+    pos_world_slice = (invViewMatrix * pos_view).xyz;
 
 //    pos_proj.xy = 0.5 * pos_hybrid.xy;
 //    gl_Position = projMatrix * vec4(pos_view, 1);
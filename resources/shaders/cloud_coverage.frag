@@ -0,0 +1,59 @@
+#version 330 core
+
+// A rectangle of the coverage map, as generateCoverageRect computes it on
+// the CPU: texel k of the map, counted in the clouds' frame, is sampled at
+// (k + 0.5) * texelSize world units. Fragments are at the texels' places in
+// the texture, texelOffset from where they are in the map. The gradient
+// table is the 2D one.
+
+#include "cloud_lattice.glsl"
+
+uniform ivec2 texelOffset;
+uniform float texelSize;
+
+// Octaves resolved as on the CPU: (frequency, amplitude, period, offset),
+// for the coverage and the cloud type
+const int maxOctaves = 16;
+uniform vec4 coverageOctaves[maxOctaves];
+uniform vec4 typeOctaves[maxOctaves];
+uniform int numOctaves;
+
+// Coverage and type are amount + contrast * fbm, clamped to [0, 1]
+uniform vec2 amount;
+uniform vec2 contrast;
+
+out vec2 coverage;
+
+// Same noise as noise::perlin2
+float perlin2(vec4 octave, vec2 p) {
+    p *= octave.x;
+    int period = int(octave.z);
+    int offset = int(octave.w);
+    vec2 pf = floor(p);
+    ivec2 P = ivec2(pf);
+    int X0 = latticeIndex(P.x, period, offset);
+    int X1 = latticeIndex(P.x + 1, period, offset);
+    int Y0 = latticeIndex(P.y, period, 0);
+    int Y1 = latticeIndex(P.y + 1, period, 0);
+    vec2 f = p - pf;
+
+    int hA = perm(X0);
+    int hB = perm(X1);
+    float d00 = dot(gradient(perm(hA + Y0)).xy, f);
+    float d10 = dot(gradient(perm(hB + Y0)).xy, f - vec2(1, 0));
+    float d01 = dot(gradient(perm(hA + Y1)).xy, f - vec2(0, 1));
+    float d11 = dot(gradient(perm(hB + Y1)).xy, f - vec2(1, 1));
+
+    vec2 t = fade(f);
+    return mix(mix(d00, d10, t.x), mix(d01, d11, t.x), t.y);
+}
+
+void main() {
+    vec2 p = (vec2(ivec2(gl_FragCoord.xy) + texelOffset) + 0.5) * texelSize;
+    vec2 sum = vec2(0);
+    for (int i = 0; i < numOctaves; i++) {
+        sum.x += coverageOctaves[i].y * perlin2(coverageOctaves[i], p);
+        sum.y += typeOctaves[i].y * perlin2(typeOctaves[i], p);
+    }
+    coverage = clamp(amount + contrast * sum, 0, 1);
+}
@@ -0,0 +1,154 @@
+// The clouds' density, as every cloud shader samples it: cloud.frag for the
+// slices, cloud_march.frag, and the light passes cloud_light.frag and
+// cloud_lightvolume.frag. ShaderLoader expands it where each of them
+// includes it.
+
+uniform vec3 noiseSampleScale;
+// The clouds' shape, its density in alpha
+uniform sampler3D noiseTex;
+
+// Animation: the noise drifts by noiseOffset and is displaced by sine waves
+// of warpAmount, with warpFrequency periods per texture, at warpPhase. Its
+// density fades by noiseBlend into noiseFadeTex, which holds the density
+// half the texture away in one channel.
+uniform sampler3D noiseFadeTex;
+uniform vec3 noiseOffset;
+uniform float warpAmount;
+uniform float warpFrequency;
+uniform vec3 warpPhase;
+uniform float noiseBlend;
+
+// With sparse set, the shape is the noise without its period where a brick
+// of it is resident: a window of brickWindow bricks of brickSize samples,
+// at sparseResolution samples per texture, starting sparseShift samples
+// before the noise's coordinates. Texel (brick + brickTableShift) %
+// brickWindow of brickTable is the brick's slot in brickAtlas in xyz, with
+// w 2 if it is resident and 1 if it is empty. Slots have a sample of
+// margin on every side. The texel of brickWeights at the same place is how
+// much of the shape comes from the brick: it only reaches 1 once the brick
+// and its neighbours are all there, and ramps up as they arrive, so that
+// the shape blends into the tiling noise towards the window's edge and
+// missing bricks.
+uniform bool sparse = false;
+uniform usampler3D brickTable;
+uniform sampler3D brickAtlas;
+uniform sampler3D brickWeights;
+uniform ivec3 brickWindow;
+uniform ivec3 brickTableShift;
+uniform vec3 sparseShift;
+uniform float sparseResolution;
+uniform float brickSize;
+uniform vec3 atlasSize;
+
+// With covered set, coverageTex maps the clouds over the xz plane, moving
+// with them, coverageShift ahead of world space. Its red, the coverage,
+// scales the shape, and its green, the cloud type, squashes the height
+// profile towards cloudFloor, to flatCloudHeight of its height at 0. It
+// covers coverageMapSize around the y axis, and beyond that changes nothing.
+uniform bool covered = false;
+uniform sampler2D coverageTex;
+uniform vec2 coverageShift;
+uniform float coverageMapSize;
+uniform float coverageTexelSize;
+uniform float cloudFloor;
+uniform float flatCloudHeight;
+
+// The height profile, over heightTexHeight units above startHeight
+uniform float startHeight;
+uniform uint heightTexHeight;
+uniform sampler1D heightTex;
+
+// The layer curves down away from the y axis: curveRadius from it, it is a
+// unit lower than at the axis
+const float curveRadius = 20;
+
+// Height of p in the layer: y - startHeight + (|xz| / curveRadius)^2
+float layerHeight(vec3 p) {
+    return p.y - startHeight + dot(p.xz, p.xz) / (curveRadius * curveRadius);
+}
+
+// Texture coordinates of the noise at world position p
+vec3 noiseCoord(vec3 p) {
+    vec3 coord = p / noiseSampleScale + noiseOffset;
+    return coord + warpAmount * sin(6.2831853 * warpFrequency * coord.zxy + warpPhase);
+}
+
+// Coverage (x) and cloud type (y) of the column at p
+vec2 coverageAt(vec3 p) {
+    if (!covered || any(greaterThan(abs(p.xz), vec2(coverageMapSize / 2 - coverageTexelSize))))
+        return vec2(1);
+    return textureLod(coverageTex, (p.xz + coverageShift) / coverageMapSize, 0).rg;
+}
+
+// How much a cloud type squashes the height profile
+float heightSquash(float type) {
+    return mix(flatCloudHeight, 1, type);
+}
+
+// Height at which the profile is read at layer height h, squashed by type
+float profileHeight(float h, float type) {
+    return cloudFloor + (h - cloudFloor) / heightSquash(type);
+}
+
+// The brick at coord: its texture coordinates in brickAtlas, and in w
+// whether it is resident (2), empty (1) or missing (0)
+vec4 findBrick(vec3 coord) {
+    if (!sparse) return vec4(0);
+    vec3 s = coord * sparseResolution + sparseShift;
+    ivec3 brick = ivec3(floor(s / brickSize));
+    if (any(lessThan(brick, ivec3(0))) || any(greaterThanEqual(brick, brickWindow)))
+        return vec4(0);
+    uvec4 entry = texelFetch(brickTable, (brick + brickTableShift) % brickWindow, 0);
+    vec3 texel = vec3(entry.xyz) * (brickSize + 2) + 1 + s - vec3(brick) * brickSize;
+    return vec4(texel / atlasSize, entry.w);
+}
+
+// How much of the shape at coord comes from the sparse volume rather than
+// the tiling noise, filtered from brickWeights between brick centers. It is
+// 0 outside the window.
+float brickWeight(vec3 coord) {
+    vec3 b = (coord * sparseResolution + sparseShift) / brickSize;
+    if (any(lessThan(b, vec3(0))) || any(greaterThanEqual(b, vec3(brickWindow))))
+        return 0.0;
+    return textureLod(brickWeights, (b + vec3(brickTableShift)) / vec3(brickWindow), 0).r;
+}
+
+// Density of the shape at mip level lod: from the sparse volume, blended by
+// brickWeight into the tiling noise. Each is only looked up where it has
+// some weight.
+float sampleShape(vec3 coord, float lod) {
+    if (!sparse) return textureLod(noiseTex, coord, lod).a;
+    float weight = brickWeight(coord);
+    float d = 0.0;
+    if (weight > 0) {
+        vec4 brick = findBrick(coord);
+        if (brick.w == 2) d = textureLod(brickAtlas, brick.xyz, lod).a;
+    }
+    if (weight < 1) d = mix(textureLod(noiseTex, coord, lod).a, d, weight);
+    return d;
+}
+
+// The same, faded for the animation. noiseFadeTex only holds the tiling
+// noise, so with the sparse volume the shape half the texture away is
+// looked up instead. The fade is only looked up while the noise is fading.
+float shapeDensity(vec3 coord, float lod) {
+    float d = sampleShape(coord, lod);
+    if (noiseBlend > 0) {
+        float faded = sparse ? sampleShape(coord + 0.5, lod)
+                             : textureLod(noiseFadeTex, coord, lod).r;
+        d = mix(d, faded, noiseBlend);
+    }
+    return d;
+}
+
+// Opacity of a unit length of cloud at p, whose noise has density noise,
+// at layer height h in a column of cloud type type: cut off below the
+// horizon and outside the layer, shaped by the height profile, and given a
+// harder edge
+float cloudDensity(float noise, vec3 p, float h, float type) {
+    if (h < 0 || h >= heightTexHeight) return 0.0;
+    float d = noise * smoothstep(startHeight, startHeight + 2, p.y);
+    d *= textureLod(heightTex, profileHeight(h, type) / heightTexHeight, 0).r;
+    if (d <= 0) return 0.0;
+    return 0.5 * smoothstep(0, 0.1, d);
+}
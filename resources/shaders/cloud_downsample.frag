@@ -0,0 +1,28 @@
+#version 330 core
+
+// Writes, for each texel of the low-resolution cloud target, the farthest
+// scene depth among the full-resolution pixels it covers. Clouds are then
+// drawn wherever any of those pixels can see them, and the upsample pass
+// masks them back off the nearer pixels.
+//
+// The same pass builds the tile depth that slices are culled against, with
+// one texel per tile.
+
+uniform sampler2D sceneDepth;
+uniform ivec2 lowResSize;
+
+void main() {
+    ivec2 sceneSize = textureSize(sceneDepth, 0);
+    vec2 scale = vec2(sceneSize) / vec2(lowResSize);
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    ivec2 begin = ivec2(floor(texel * scale));
+    ivec2 end = min(ivec2(ceil((texel + 1) * scale)), sceneSize);
+
+    float depth = 0;
+    for (int y = begin.y; y < end.y; y++) {
+        for (int x = begin.x; x < end.x; x++) {
+            depth = max(depth, texelFetch(sceneDepth, ivec2(x, y), 0).r);
+        }
+    }
+    gl_FragDepth = depth;
+}
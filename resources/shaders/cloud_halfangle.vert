@@ -0,0 +1,73 @@
+#version 330 core
+
+// One half-angle slice, the plane dot(sliceAxis, x) = slicePlane, made of
+// one quad per screen tile like cloud.vert's slices. The plane is at most 45
+// degrees from facing the camera, so each view ray within the frustum meets
+// it exactly once, and all of them in front of the camera or all behind.
+uniform vec3 sliceAxis;
+uniform float slicePlane;
+// Distance between slices, along sliceAxis
+uniform float sliceStep;
+
+// Farthest scene depth in each tile. Tiles where the slice is behind that
+// collapse to a point, so they are never rasterized.
+uniform sampler2D tileDepth;
+
+const vec2 corners[6] = vec2[6](
+    vec2( 1,  1), vec2(-1,  1), vec2(-1, -1),
+    vec2( 1,  1), vec2(-1, -1), vec2( 1, -1));
+
+uniform mat4 viewMatrix;
+uniform mat4 invViewMatrix;
+uniform mat4 projMatrix;
+uniform mat4 invProjMatrix;
+uniform vec3 cameraPos;
+
+out vec3 pos_world_slice;
+flat out float sliceDepth;
+flat out float sliceSpacing;
+
+// View-space direction through a point in NDC, with z = -1, so that a
+// point at view depth t along it is t times it
+vec3 viewRay(vec2 ndc) {
+    vec4 p = invProjMatrix * vec4(ndc, 0, 1);
+    return p.xyz / -p.z;
+}
+
+void main() {
+    ivec2 tiles = textureSize(tileDepth, 0);
+    int tileIndex = gl_VertexID / 6;
+    ivec2 tile = ivec2(tileIndex % tiles.x, tileIndex / tiles.x);
+    vec2 corner = (tile + 0.5 + 0.5 * corners[gl_VertexID % 6]) / tiles * 2 - 1;
+
+    // The plane in view space: dot(normal, p) = offset, so the ray r meets
+    // it at depth offset / dot(normal, r)
+    vec3 normal = mat3(viewMatrix) * sliceAxis;
+    float offset = slicePlane - dot(sliceAxis, cameraPos);
+
+    // 1 / depth is linear across the screen, so the nearest point of the
+    // slice in the tile is at a corner. Depth test that (GL_LESS).
+    float nearest = 1e30;
+    for (int i = 0; i < 4; i++) {
+        vec2 tileCorner = (tile + vec2(i & 1, i >> 1)) / tiles * 2 - 1;
+        nearest = min(nearest, offset / dot(normal, viewRay(tileCorner)));
+    }
+    vec4 nearest_proj = projMatrix * vec4(0, 0, -nearest, 1);
+    if (nearest <= 0
+            || (nearest_proj.z / nearest_proj.w) * 0.5 + 0.5
+                > texelFetch(tileDepth, tile, 0).r) {
+        gl_Position = vec4(0, 0, 0, 1);
+        return;
+    }
+
+    vec3 ray = viewRay(corner);
+    vec4 pos_view = vec4(ray * offset / dot(normal, ray), 1);
+    pos_world_slice = (invViewMatrix * pos_view).xyz;
+    gl_Position = projMatrix * pos_view;
+
+    // The slice's depth, and the depth to the next slice, vary across the
+    // screen. Take them at the tile's center.
+    vec3 centerRay = viewRay((tile + 0.5) / tiles * 2 - 1);
+    sliceDepth = offset / dot(normal, centerRay);
+    sliceSpacing = sliceStep / abs(dot(normal, centerRay));
+}
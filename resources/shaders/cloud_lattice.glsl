@@ -0,0 +1,44 @@
+// The lattice hash and gradient lookup of noise/perlin, shared by the
+// shaders that generate noise on the GPU: cloud_noise.frag for the 3D noise
+// and cloud_coverage.frag for the 2D coverage map. ShaderLoader expands it
+// where each of them includes it.
+
+// The gradient table: the doubled permutation, and the gradients, whose
+// unused components read as 0
+uniform isampler1D permTex;
+uniform sampler1D gradientTex;
+
+const int mask = 255;
+
+vec2 fade(vec2 t) {
+    return t * t * (3 - 2 * t);
+}
+
+vec3 fade(vec3 t) {
+    return t * t * (3 - 2 * t);
+}
+
+// Same hash as noise::detail::hashLattice
+int hashLattice(int i) {
+    uint h = uint(i) * 0x9e3779b1u;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    return int(h >> 24);
+}
+
+int latticeIndex(int i, int period, int offset) {
+    if (period == 0) {
+        return hashLattice(i + offset);
+    }
+    i %= period;
+    if (i < 0) i += period;
+    return (i + offset) & mask;
+}
+
+int perm(int i) {
+    return texelFetch(permTex, i, 0).r;
+}
+
+vec3 gradient(int h) {
+    return texelFetch(gradientTex, h, 0).xyz;
+}
@@ -0,0 +1,45 @@
+#version 330 core
+
+// One half-angle slice as the light sees it: the opacity it adds along each
+// light ray through the light buffer, blended over the slices before it.
+// Only the clouds' shape is sampled: their detail averages out at the
+// coarse mips used here.
+
+#include "cloud_density.glsl"
+
+in vec2 uv;
+
+// Light buffer texel uv is the light ray through
+// lightOrigin + uv.x * lightRight + uv.y * lightUp
+uniform vec3 lightOrigin;
+uniform vec3 lightRight;
+uniform vec3 lightUp;
+uniform vec3 lightDir;
+
+// The slice, dot(sliceAxis, x) = slicePlane, and the distance along a light
+// ray to the next one
+uniform vec3 sliceAxis;
+uniform float slicePlane;
+uniform float lightStep;
+
+// Mip level of the shape for a light buffer texel
+uniform float noiseLod;
+uniform vec2 heightOccupied;
+
+out float opacity;
+
+void main() {
+    vec3 p = lightOrigin + uv.x * lightRight + uv.y * lightUp;
+    p += lightDir * (slicePlane - dot(sliceAxis, p)) / dot(sliceAxis, lightDir);
+
+    float h = layerHeight(p);
+    if (p.y <= startHeight || h < heightOccupied.x || h > heightOccupied.y) discard;
+    vec2 cover = coverageAt(p);
+    if (cover.x <= 0) discard;
+
+    float density = cloudDensity(cover.x * shapeDensity(noiseCoord(p), noiseLod),
+                                 p, h, cover.y);
+    if (density <= 0) discard;
+
+    opacity = 1 - pow(1 - density, lightStep);
+}
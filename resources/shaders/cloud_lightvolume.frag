@@ -0,0 +1,47 @@
+#version 330 core
+
+// One layer of the light volume: the transmittance from each voxel's center
+// towards the light, marched to where the ray leaves the volume's box. Only
+// the clouds' shape is sampled: the detail is much finer than a step.
+
+#include "cloud_density.glsl"
+
+in vec2 uv;
+
+uniform vec3 volumeOrigin;
+uniform vec3 volumeSize;
+uniform int layer;
+uniform int layers;
+
+uniform vec3 lightDir; // direction the light travels
+uniform float stepLength;
+
+// Mip level of the shape for a step
+uniform float noiseLod;
+uniform vec2 heightOccupied;
+
+out float transmittance;
+
+// Density per unit length, of the shape only
+float density(vec3 p) {
+    float h = layerHeight(p);
+    if (p.y <= startHeight || h < heightOccupied.x || h > heightOccupied.y) return 0.0;
+    vec2 cover = coverageAt(p);
+    if (cover.x <= 0) return 0.0;
+    return cloudDensity(cover.x * shapeDensity(noiseCoord(p), noiseLod), p, h, cover.y);
+}
+
+void main() {
+    vec3 p = volumeOrigin + vec3(uv, (layer + 0.5) / layers) * volumeSize;
+    vec3 toLight = -normalize(lightDir);
+
+    // Distance to where the ray leaves the box
+    vec3 boxEnd = volumeOrigin + step(0, toLight) * volumeSize;
+    vec3 tEnd = (boxEnd - p) / toLight;
+    float tMax = min(tEnd.x, min(tEnd.y, tEnd.z));
+
+    transmittance = 1;
+    for (float t = 0.5 * stepLength; t < tMax && transmittance > 0.01; t += stepLength) {
+        transmittance *= pow(1 - density(p + t * toLight), stepLength);
+    }
+}
@@ -0,0 +1,170 @@
+#version 330 core
+
+// Ray-marched clouds. Samples the same density as cloud.frag, but along one
+// ray per pixel: only where the ray crosses the cloud layer, in large steps
+// until it finds density, and only until the pixel is nearly opaque.
+
+#include "cloud_density.glsl"
+
+in vec2 uv;
+
+uniform mat4 invViewMatrix;
+uniform mat4 invProjMatrix;
+uniform vec3 cameraPos;
+
+// Depth of the scene behind the clouds
+uniform sampler2D sceneDepth;
+
+uniform vec3 cloudColor;
+// Mip level of noiseTex at distance t is log2(t * noiseLodScale)
+uniform float noiseLodScale;
+// Detail, combined with noiseTex as in cloud.frag, and its mip level
+// log2(t * detailLodScale)
+uniform sampler3D detailTex;
+uniform float detailRepeat;
+uniform float detailFade;
+uniform float detailLodScale;
+
+// If set, cloudColor is shaded by the transmittance towards the light
+// precomputed in lightVolume (see cloud.frag)
+uniform bool lit = false;
+uniform sampler3D lightVolume;
+uniform vec3 lightVolumeOrigin;
+uniform vec3 lightVolumeSize;
+uniform float cloudAmbient;
+
+// The cloud layer: heights (after the curve) where heightTex is nonzero
+uniform float cloudFloorStart;
+uniform float cloudCeilEnd;
+
+uniform float emptyStep;
+uniform float denseStep;
+uniform float minTransmittance;
+uniform int maxSteps;
+
+out vec4 color;
+
+const float infinity = 1e30;
+
+// Opacity of a unit length of cloud at p, as cloud.frag computes it for
+// one slice before raising its transparency to the power sliceSpacing
+float density(vec3 p, float t) {
+    float h = layerHeight(p);
+    if (h < 0 || h >= heightTexHeight) return 0.0;
+    vec2 cover = coverageAt(p);
+    if (cover.x <= 0) return 0.0;
+
+    float lod = log2(max(t * noiseLodScale, 1));
+    vec3 coord = noiseCoord(p);
+    float shape = cover.x * shapeDensity(coord, lod);
+    if (shape <= 0) return 0.0;
+    float detailLod = log2(max(t * detailLodScale, 1));
+    // Not faded, as in cloud.frag
+    float detail = textureLod(detailTex, coord * detailRepeat, detailLod).a;
+    return cloudDensity(shape + min(shape / detailFade, 1) * detail, p, h, cover.y);
+}
+
+// Height along the ray is the quadratic a t^2 + b t + c. Returns the interval
+// of t where it is at most k (t0 > t1 if there is none).
+vec2 belowHeight(float a, float b, float c, float k) {
+    c -= k;
+    if (a < 1e-8) {
+        // Vertical ray: linear in t
+        if (abs(b) < 1e-8) return c <= 0 ? vec2(-infinity, infinity) : vec2(infinity, -infinity);
+        float t = -c / b;
+        return b > 0 ? vec2(-infinity, t) : vec2(t, infinity);
+    }
+    float disc = b * b - 4 * a * c;
+    if (disc < 0) return vec2(infinity, -infinity);
+    // Numerically stable roots
+    float q = -0.5 * (b + (b < 0 ? -sqrt(disc) : sqrt(disc)));
+    float r0 = q / a;
+    float r1 = abs(q) > 0 ? c / q : r0;
+    return vec2(min(r0, r1), max(r0, r1));
+}
+
+vec3 shade(vec3 p) {
+    if (!lit) return cloudColor;
+    float lightTransmittance = texture(lightVolume,
+            (p - lightVolumeOrigin) / lightVolumeSize).r;
+    return cloudColor * mix(cloudAmbient, 1, lightTransmittance);
+}
+
+vec3 accumulated = vec3(0);
+float transmittance = 1;
+int steps = 0;
+
+// Marches [t0, t1] front to back
+void march(vec3 ro, vec3 rd, float t0, float t1) {
+    float t = t0;
+    bool coarse = true;
+    int emptyRun = 0;
+    while (t < t1 && steps < maxSteps) {
+        steps++;
+        if (coarse) {
+            if (density(ro + rd * t, t) > 0) {
+                // Entered a cloud: back up and refine
+                coarse = false;
+                emptyRun = 0;
+                t = max(t0, t - emptyStep);
+            } else {
+                t += emptyStep;
+            }
+            continue;
+        }
+
+        float dt = min(denseStep, t1 - t);
+        vec3 p = ro + rd * (t + 0.5 * dt);
+        float d = density(p, t);
+        if (d > 0) {
+            float alpha = 1 - pow(1 - d, dt);
+            accumulated += transmittance * alpha * shade(p);
+            transmittance *= 1 - alpha;
+            emptyRun = 0;
+            if (transmittance < minTransmittance) return;
+        } else if (++emptyRun >= 4) {
+            coarse = true;
+        }
+        t += dt;
+    }
+}
+
+vec3 worldAt(float depth) {
+    vec4 view = invProjMatrix * vec4(uv * 2 - 1, depth * 2 - 1, 1);
+    return (invViewMatrix * vec4(view.xyz / view.w, 1)).xyz;
+}
+
+void main() {
+    vec3 ro = cameraPos;
+    vec3 rd = normalize(worldAt(1) - ro);
+    // March up to the scene, or the far plane where there is none
+    float tMax = distance(worldAt(texture(sceneDepth, uv).r), ro);
+
+    // Coefficients of the height along the ray
+    float inv = 1 / (curveRadius * curveRadius);
+    float a = dot(rd.xz, rd.xz) * inv;
+    float b = rd.y + 2 * dot(ro.xz, rd.xz) * inv;
+    float c = ro.y - startHeight + dot(ro.xz, ro.xz) * inv;
+
+    // The layer is below the ceiling but not below the floor. That leaves
+    // up to two intervals, entering and leaving through the floor's hole.
+    vec2 belowCeil = belowHeight(a, b, c, cloudCeilEnd);
+    vec2 belowFloor = belowHeight(a, b, c, cloudFloorStart);
+    vec2 first = vec2(belowCeil.x, belowCeil.y);
+    vec2 second = vec2(infinity, -infinity);
+    if (belowFloor.x < belowFloor.y) {
+        first.y = min(belowCeil.y, belowFloor.x);
+        second = vec2(max(belowCeil.x, belowFloor.y), belowCeil.y);
+    }
+
+    first = clamp(first, 0, tMax);
+    second = clamp(second, 0, tMax);
+    if (first.x < first.y) march(ro, rd, first.x, first.y);
+    if (second.x < second.y && transmittance >= minTransmittance) {
+        march(ro, rd, second.x, second.y);
+    }
+
+    if (transmittance >= 1) discard;
+    // Premultiplied, blended with (ONE, ONE_MINUS_SRC_ALPHA)
+    color = vec4(accumulated, 1 - transmittance);
+}
@@ -0,0 +1,85 @@
+#version 330 core
+
+// One z layer of fbm samples and their gradients, as noise::fbm3GradTile
+// computes them on the CPU: voxel (x, y, z) of a resolution^3 volume is
+// sampled at its center, (x + 0.5, y + 0.5, z + 0.5) / resolution.
+
+#include "cloud_lattice.glsl"
+
+uniform int resolution;
+uniform int layer;
+
+// Octaves resolved as on the CPU: (frequency, amplitude, period, offset)
+const int maxOctaves = 16;
+uniform vec4 octaves[maxOctaves];
+uniform int numOctaves;
+
+// The gradient in xyz, and the value in w
+out vec4 sampleValue;
+
+vec3 fadeDerivative(vec3 t) {
+    return 6 * t * (1 - t);
+}
+
+// The octave's value in w, and its gradient in xyz
+vec4 perlin3Grad(vec4 octave, vec3 p) {
+    p *= octave.x;
+    int period = int(octave.z);
+    int offset = int(octave.w);
+    vec3 pf = floor(p);
+    ivec3 P = ivec3(pf);
+    int X0 = latticeIndex(P.x, period, offset);
+    int X1 = latticeIndex(P.x + 1, period, offset);
+    int Y0 = latticeIndex(P.y, period, 0);
+    int Y1 = latticeIndex(P.y + 1, period, 0);
+    int Z0 = latticeIndex(P.z, period, 0);
+    int Z1 = latticeIndex(P.z + 1, period, 0);
+    vec3 f = p - pf;
+
+    int hA = perm(X0);
+    int hB = perm(X1);
+    int hAA = perm(hA + Y0);
+    int hBA = perm(hB + Y0);
+    int hAB = perm(hA + Y1);
+    int hBB = perm(hB + Y1);
+
+    vec3 g000 = gradient(perm(hAA + Z0));
+    vec3 g100 = gradient(perm(hBA + Z0));
+    vec3 g010 = gradient(perm(hAB + Z0));
+    vec3 g110 = gradient(perm(hBB + Z0));
+    vec3 g001 = gradient(perm(hAA + Z1));
+    vec3 g101 = gradient(perm(hBA + Z1));
+    vec3 g011 = gradient(perm(hAB + Z1));
+    vec3 g111 = gradient(perm(hBB + Z1));
+    float d000 = dot(g000, f);
+    float d100 = dot(g100, f - vec3(1, 0, 0));
+    float d010 = dot(g010, f - vec3(0, 1, 0));
+    float d110 = dot(g110, f - vec3(1, 1, 0));
+    float d001 = dot(g001, f - vec3(0, 0, 1));
+    float d101 = dot(g101, f - vec3(1, 0, 1));
+    float d011 = dot(g011, f - vec3(0, 1, 1));
+    float d111 = dot(g111, f - vec3(1, 1, 1));
+
+    vec3 t = fade(f);
+    // The blend of the corners' gradients, plus the change in their weights
+    // along each axis
+    vec3 blend = mix(mix(mix(g000, g100, t.x), mix(g010, g110, t.x), t.y),
+                     mix(mix(g001, g101, t.x), mix(g011, g111, t.x), t.y), t.z);
+    float x0 = mix(mix(d000, d010, t.y), mix(d001, d011, t.y), t.z);
+    float x1 = mix(mix(d100, d110, t.y), mix(d101, d111, t.y), t.z);
+    float y0 = mix(mix(d000, d100, t.x), mix(d001, d101, t.x), t.z);
+    float y1 = mix(mix(d010, d110, t.x), mix(d011, d111, t.x), t.z);
+    float z0 = mix(mix(d000, d100, t.x), mix(d010, d110, t.x), t.y);
+    float z1 = mix(mix(d001, d101, t.x), mix(d011, d111, t.x), t.y);
+    vec3 grad = octave.x * (blend + fadeDerivative(f) * vec3(x1 - x0, y1 - y0, z1 - z0));
+    return vec4(grad, mix(z0, z1, t.z));
+}
+
+void main() {
+    vec3 p = vec3(gl_FragCoord.xy, layer + 0.5) / resolution;
+    vec4 sum = vec4(0);
+    for (int i = 0; i < numOctaves; i++) {
+        sum += octaves[i].y * perlin3Grad(octaves[i], p);
+    }
+    sampleValue = sum;
+}
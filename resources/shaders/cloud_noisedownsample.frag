@@ -0,0 +1,30 @@
+#version 330 core
+
+// One z layer of a mipmap level of the noise or fade texture: the average of
+// each box of the level above, as the CPU's downsample computes it. The
+// level above is the only one in the texture's range while this draws, so
+// it is fetched as level 0.
+
+uniform sampler3D noiseTex;
+uniform int size;      // of the source, per side
+uniform int layer;
+
+out vec4 noise;
+
+void main() {
+    int m = max(size / 2, 1);
+    ivec3 coord = ivec3(ivec2(gl_FragCoord.xy), layer);
+    ivec3 begin = coord * size / m;
+    ivec3 end = (coord + 1) * size / m;
+
+    vec4 sum = vec4(0);
+    for (int k = begin.z; k < end.z; k++) {
+    for (int j = begin.y; j < end.y; j++) {
+    for (int i = begin.x; i < end.x; i++) {
+        sum += texelFetch(noiseTex, ivec3(i, j, k), 0);
+    }
+    }
+    }
+    ivec3 count = end - begin;
+    noise = sum / float(count.x * count.y * count.z);
+}
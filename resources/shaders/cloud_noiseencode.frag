@@ -0,0 +1,23 @@
+#version 330 core
+
+// One z layer of the noise texture, from the fbm samples, as encodeSamples
+// computes it on the CPU. Unorm targets clamp the density as it does. Also
+// the fade texture's layer: the density half the texture away, as
+// fadeDensity computes it.
+
+uniform sampler3D samplesTex;
+uniform int resolution;
+uniform int layer;
+// The gradient is stored as gradient * gradientScale + gradientBias
+uniform float gradientScale;
+uniform float gradientBias;
+
+layout(location = 0) out vec4 noise;
+layout(location = 1) out float fade;
+
+void main() {
+    ivec3 coord = ivec3(ivec2(gl_FragCoord.xy), layer);
+    vec4 s = texelFetch(samplesTex, coord, 0);
+    noise = vec4(s.xyz * gradientScale + gradientBias, s.w);
+    fade = texelFetch(samplesTex, (coord + resolution / 2) % resolution, 0).w;
+}
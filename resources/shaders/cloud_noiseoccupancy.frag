@@ -0,0 +1,39 @@
+#version 330 core
+
+// One z layer of the occupancy texture: the density range over each brick,
+// widened by margin samples, and over the samples half the texture away, as
+// generateOccupancy computes it on the CPU. Also the largest gradient
+// component over the same samples, which the gradient's encoding is fitted
+// to.
+
+uniform sampler3D samplesTex;
+uniform int resolution;
+uniform int bricks; // per side
+uniform int margin;
+uniform int layer;
+
+layout(location = 0) out vec2 range;
+layout(location = 1) out float gradientRange;
+
+void main() {
+    ivec3 brick = ivec3(ivec2(gl_FragCoord.xy), layer);
+    ivec3 begin = brick * resolution / bricks - margin;
+    ivec3 end = ((brick + 1) * resolution + bricks - 1) / bricks + margin;
+    // Shifted by half the texture, and kept positive so that % wraps
+    ivec3 shift = ivec3(resolution / 2 + resolution);
+
+    range = vec2(1e30, -1e30);
+    gradientRange = 0;
+    for (int k = begin.z; k < end.z; k++) {
+    for (int j = begin.y; j < end.y; j++) {
+    for (int i = begin.x; i < end.x; i++) {
+        ivec3 coord = ivec3(i, j, k) + resolution;
+        vec4 a = texelFetch(samplesTex, coord % resolution, 0);
+        float b = texelFetch(samplesTex, (coord + shift) % resolution, 0).a;
+        range = vec2(min(range.x, min(a.a, b)), max(range.y, max(a.a, b)));
+        vec3 g = abs(a.xyz);
+        gradientRange = max(gradientRange, max(g.x, max(g.y, g.z)));
+    }
+    }
+    }
+}
@@ -0,0 +1,12 @@
+#version 330 core
+
+// Keeps only the texels of the cloud target that are nearly opaque, so the
+// stencil can mark them. Slices drawn front to back after that are rejected
+// there before shading.
+
+uniform sampler2D cloudTex; // premultiplied, accumulated front to back
+uniform float saturationAlpha;
+
+void main() {
+    if (texelFetch(cloudTex, ivec2(gl_FragCoord.xy), 0).a < saturationAlpha) discard;
+}
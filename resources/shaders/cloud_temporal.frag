@@ -0,0 +1,67 @@
+#version 330 core
+
+// Blends this frame's clouds into the history of previous frames. The
+// history is reprojected through the scene depth the clouds were drawn
+// against, and clipped to the spread of the current frame's 3x3
+// neighbourhood so that it cannot ghost where the clouds have changed.
+
+in vec2 uv;
+
+uniform sampler2D currentTex;   // premultiplied
+uniform sampler2D currentDepth;
+uniform sampler2D historyTex;   // premultiplied, from the previous frame
+
+uniform mat4 invViewProj;
+uniform mat4 prevViewProj;
+uniform bool historyValid;
+
+// Weight of the current frame
+uniform float blend;
+// Half-width of the clipping box, in standard deviations
+uniform float clampGamma;
+
+out vec4 color;
+
+// Clips history towards the center of the box, like a ray from center
+// through history stopping at the box's surface
+vec4 clipToBox(vec4 history, vec4 center, vec4 extent) {
+    vec4 offset = history - center;
+    vec4 units = abs(offset) / max(extent, vec4(1e-4));
+    float maxUnit = max(max(units.x, units.y), max(units.z, units.w));
+    return maxUnit > 1 ? center + offset / maxUnit : history;
+}
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    vec4 current = texelFetch(currentTex, texel, 0);
+
+    // Mean and standard deviation of the neighbourhood
+    vec4 m1 = vec4(0);
+    vec4 m2 = vec4(0);
+    ivec2 maxTexel = textureSize(currentTex, 0) - 1;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            vec4 c = texelFetch(currentTex, clamp(texel + ivec2(x, y), ivec2(0), maxTexel), 0);
+            m1 += c;
+            m2 += c * c;
+        }
+    }
+    m1 /= 9;
+    vec4 sigma = sqrt(max(m2 / 9 - m1 * m1, vec4(0)));
+
+    // Where this pixel's point was on the previous frame's screen
+    float depth = texelFetch(currentDepth, texel, 0).r;
+    vec4 world = invViewProj * vec4(uv * 2 - 1, depth * 2 - 1, 1);
+    vec4 prevClip = prevViewProj * vec4(world.xyz / world.w, 1);
+    vec2 prevUV = prevClip.xy / prevClip.w * 0.5 + 0.5;
+
+    bool onScreen = prevClip.w > 0 && all(greaterThanEqual(prevUV, vec2(0)))
+            && all(lessThanEqual(prevUV, vec2(1)));
+    if (!historyValid || !onScreen) {
+        color = current;
+        return;
+    }
+
+    vec4 history = clipToBox(texture(historyTex, prevUV), m1, clampGamma * sigma);
+    color = mix(history, current, blend);
+}
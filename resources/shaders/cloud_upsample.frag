@@ -0,0 +1,70 @@
+#version 330 core
+
+// Upsamples the low-resolution clouds onto the scene. Each pixel blends the
+// four nearest low-resolution texels bilinearly, but only those drawn against
+// about the pixel's own depth. Where the texels were drawn against the scene
+// behind the pixel, as along a terrain silhouette, their clouds may be behind
+// it too, so it takes the texel around it nearest its depth instead.
+
+in vec2 uv;
+
+uniform sampler2D cloudTex;   // premultiplied
+uniform sampler2D cloudDepth; // depth the clouds were drawn against
+uniform sampler2D sceneDepth; // full resolution
+
+// projMatrix[2][2], [3][2], [2][3] and [3][3], to linearize depth
+uniform vec4 depthParams;
+
+out vec4 color;
+
+// How far, relative to the pixel's depth, a texel's depth may be from it
+const float depthTolerance = 0.1;
+
+// Distance in front of the camera of a depth buffer value
+float linearDepth(float depth) {
+    float ndc = depth * 2 - 1;
+    return (ndc * depthParams.w - depthParams.y) / (ndc * depthParams.z - depthParams.x);
+}
+
+void main() {
+    ivec2 lowResSize = textureSize(cloudTex, 0);
+    float pixelDepth = linearDepth(texture(sceneDepth, uv).r);
+
+    vec2 f = uv * lowResSize - 0.5;
+    ivec2 base = ivec2(floor(f));
+    vec2 t = f - base;
+
+    vec4 sum = vec4(0);
+    float weightSum = 0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 texel = clamp(base + offset, ivec2(0), lowResSize - 1);
+        float texelDepth = linearDepth(texelFetch(cloudDepth, texel, 0).r);
+        if (abs(texelDepth - pixelDepth) > depthTolerance * pixelDepth) continue;
+        vec2 bilinear = mix(1 - t, t, vec2(offset));
+        float weight = bilinear.x * bilinear.y;
+        sum += weight * texelFetch(cloudTex, texel, 0);
+        weightSum += weight;
+    }
+    if (weightSum > 0) {
+        color = sum / weightSum;
+        return;
+    }
+
+    // None of them match: the texel of the 3x3 around the pixel nearest its
+    // depth. The downsample keeps the farthest depth, so near a silhouette
+    // none may be within the tolerance, and dropping the clouds there would
+    // cut them off in a band along it.
+    ivec2 center = ivec2(uv * lowResSize);
+    float bestError = 1e30;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            ivec2 texel = clamp(center + ivec2(x, y), ivec2(0), lowResSize - 1);
+            float error = abs(linearDepth(texelFetch(cloudDepth, texel, 0).r) - pixelDepth);
+            if (error < bestError) {
+                bestError = error;
+                color = texelFetch(cloudTex, texel, 0);
+            }
+        }
+    }
+}
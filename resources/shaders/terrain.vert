@@ -0,0 +1,10 @@
+#version 410 core
+
+// Corner of a terrain patch in the xz-plane
+layout(location = 0) in vec2 pos;
+
+out vec2 patchPos;
+
+void main() {
+    patchPos = pos;
+}
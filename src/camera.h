@@ -8,9 +8,9 @@
 class Camera {
 public:
     Camera();
-    glm::vec3 look;
-    glm::vec3 up;
-    glm::vec3 pos;
+    glm::vec3 look = {0, 0, -1};
+    glm::vec3 up = {0, 1, 0};
+    glm::vec3 pos = {0, 0, 0};
 
     float aspectRatio;
     float heightAngle;
@@ -0,0 +1,33 @@
+#include "animation.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include "params.h"
+
+namespace cloud {
+
+NoiseAnimation animateNoise(double time) {
+    NoiseAnimation animation;
+    // Features move with the wind, so the samples move against it. The noise
+    // tiles, so only the fraction of a texture matters, and keeping it small
+    // keeps it precise.
+    glm::dvec3 drift = -glm::dvec3(windVelocity) * time / glm::dvec3(noiseSampleScale);
+    animation.offset = glm::vec3(glm::fract(drift));
+    animation.drift = drift;
+    animation.warpPhase = glm::vec3(glm::mod(glm::dvec3(warpSpeed) * time,
+                                             glm::dvec3(2 * glm::pi<double>())));
+    animation.blend = 0.5 - 0.5 * glm::cos(2 * glm::pi<double>() * time / evolvePeriod);
+    return animation;
+}
+
+void setNoiseAnimationUniforms(GLuint program, const NoiseAnimation &animation) {
+    glUniform3fv(glGetUniformLocation(program, "noiseOffset"),
+                 1, &animation.offset[0]);
+    glUniform1f(glGetUniformLocation(program, "warpAmount"), warpAmount);
+    glUniform1f(glGetUniformLocation(program, "warpFrequency"), warpFrequency);
+    glUniform3fv(glGetUniformLocation(program, "warpPhase"),
+                 1, &animation.warpPhase[0]);
+    glUniform1f(glGetUniformLocation(program, "noiseBlend"), animation.blend);
+}
+
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace cloud {
+// Time-based motion of the clouds. It is applied where the shaders sample the
+// noise, so animating the clouds only changes uniforms: the noise drifts with
+// the wind, is displaced by slowly moving sine waves, and fades back and forth
+// between the noise and the same noise shifted by half the texture.
+
+struct NoiseAnimation {
+    // Drift, in noise texture coordinates, wrapped to [0, 1)
+    glm::vec3 offset = glm::vec3(0);
+    // The same, unwrapped, for noise that does not tile
+    glm::dvec3 drift = glm::dvec3(0);
+    glm::vec3 warpPhase = glm::vec3(0);
+    // Weight of the shifted noise
+    float blend = 0;
+};
+
+// The animation time seconds in
+NoiseAnimation animateNoise(double time);
+
+// Sets the animation uniforms of cloud_density.glsl on the program in use
+void setNoiseAnimationUniforms(GLuint program, const NoiseAnimation &animation);
+}
@@ -4,40 +4,91 @@
 
 #include <utils/shaderloader.h>
 
+#include "animation.h"
+#include "coverage.h"
+#include "gpunoise.h"
 #include "noise.h"
+#include "noisestream.h"
 #include "heightgrad.h"
+#include "lightbuffer.h"
+#include "lightvolume.h"
+#include "lowres.h"
+#include "occlusion.h"
 #include "params.h"
+#include "slicerange.h"
+#include "sparsevolume.h"
+#include "temporal.h"
 
 namespace cloud {
 
 bool initialized = false;
 
 GLuint cloudProgram;
-
-GLuint sliceVBO;
+GLuint marchProgram;
+// Half-angle slices, seen from the camera and from the light
+GLuint halfAngleProgram;
+GLuint lightProgram;
+
+RenderMode renderMode = RenderMode::Slices;
+int resolutionDivisor = 1;
+bool temporalAccumulation = false;
+SliceOrder sliceOrder = SliceOrder::BackToFront;
+// Direction the light travels, until setLightDirection
+glm::vec3 lightDirection(0, -1, 0);
+bool precomputedLighting = false;
+// Seconds the clouds have been animated for, and where that puts the noise
+double cloudTime = 0;
+NoiseAnimation noiseAnimation;
+
+// Slices are generated by cloud.vert, but core profiles need a VAO bound.
+// Up to numSlices of them fit before the far plane.
 GLuint sliceVAO;
-int numQuads;
-
-GLuint noiseTex;
-GLuint noiseGradTex;
+int numSlices;
+SliceLayout sliceLayout;
+float farPlane;
+
+// The noise in use, which stays in use while the noise is regenerated
+NoiseTextures noiseTextures;
+// The detail noise, which is never regenerated and has no occupancy or
+// fade texture
+NoiseTextures detailTextures;
 GLuint heightTex;
 GLuint heightGradTex;
 
+// Coarse density ranges, for skipping empty space
+glm::vec2 heightOccupied;
 
-const Camera *camera;
 
+// Copy of the scene's depth buffer, where ray marching stops
+GLuint depthFBO;
+GLuint depthTex;
+glm::ivec2 depthSize(0);
 
-// Utils
+const Camera *camera;
 
-void addVector(std::vector<GLfloat> &data, float x, float y, float z) {
-    data.push_back(x);
-    data.push_back(y);
-    data.push_back(z);
-}
 
 void defineSlicePlanes(float far);
 
 void finalizeClouds() {
+    finalizeCoverage();
+    finalizeSparseVolume();
+    finalizeGpuNoise();
+    finalizeNoiseStream();
+    finalizeLightVolume();
+    finalizeLightBuffer();
+    finalizeOcclusion();
+    finalizeTemporal();
+    finalizeLowRes();
+    glDeleteFramebuffers(1, &depthFBO);
+    glDeleteTextures(1, &depthTex);
+    glDeleteTextures(1, &detailTextures.noise);
+    glDeleteTextures(1, &noiseTextures.occupancy);
+    glDeleteTextures(1, &noiseTextures.fade);
+    glDeleteTextures(1, &noiseTextures.noise);
+    glDeleteVertexArrays(1, &sliceVAO);
+    glDeleteProgram(lightProgram);
+    glDeleteProgram(halfAngleProgram);
+    glDeleteProgram(marchProgram);
     glDeleteProgram(cloudProgram);
 }
 
@@ -48,19 +99,41 @@ void initializeClouds() {
     cloudProgram = ShaderLoader::createShaderProgram(
                 ":/resources/shaders/cloud.vert",
                 ":/resources/shaders/cloud.frag");
+    marchProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_march.frag");
+    halfAngleProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_halfangle.vert",
+                ":/resources/shaders/cloud.frag");
+    lightProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_light.frag");
 
-    glGenTextures(1, &noiseTex);
-    glBindTexture(GL_TEXTURE_3D, noiseTex);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glGenTextures(1, &noiseTextures.noise);
+    glBindTexture(GL_TEXTURE_3D, noiseTextures.noise);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_3D, 0);
 
-    glGenTextures(1, &noiseGradTex);
-    glBindTexture(GL_TEXTURE_3D, noiseGradTex);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glGenTextures(1, &noiseTextures.fade);
+    glBindTexture(GL_TEXTURE_3D, noiseTextures.fade);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_3D, 0);
 
+    glGenTextures(1, &detailTextures.noise);
+    glBindTexture(GL_TEXTURE_3D, detailTextures.noise);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    // Looked up per brick, never filtered
+    glGenTextures(1, &noiseTextures.occupancy);
+    glBindTexture(GL_TEXTURE_3D, noiseTextures.occupancy);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
     glGenTextures(1, &heightTex);
     glBindTexture(GL_TEXTURE_1D, heightTex);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -73,18 +146,66 @@ void initializeClouds() {
     glBindTexture(GL_TEXTURE_1D, 0);
 
 
-    glGenBuffers(1, &sliceVBO);
     glGenVertexArrays(1, &sliceVAO);
 
+    glGenTextures(1, &depthTex);
+    glBindTexture(GL_TEXTURE_2D, depthTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &depthFBO);
+    depthSize = glm::ivec2(0);
+
+    initializeLowRes();
+    initializeTemporal();
+    initializeOcclusion();
+    initializeLightBuffer();
+    initializeLightVolume();
+    initializeNoiseStream();
+    initializeGpuNoise();
+    initializeSparseVolume();
+    initializeCoverage();
+
     initialized = true;
 
-    generateNoise(cloudNoiseResolutions,
-                  noiseSampleResolution,
-                  noiseTex, noiseGradTex);
+    // There is no noise to show until this is done, so it is not streamed
+    if (gpuNoise) {
+        noiseTextures.gradEncoding = generateNoiseOnGpu(shapeNoise,
+                                                        noiseSampleResolution,
+                                                        noiseStorage,
+                                                        noiseTextures.noise,
+                                                        noiseTextures.fade,
+                                                        noiseTextures.occupancy);
+    } else {
+        noiseTextures.gradEncoding = generateNoise(shapeNoise,
+                                                   noiseSampleResolution,
+                                                   noiseStorage,
+                                                   noiseTextures.noise,
+                                                   noiseTextures.fade,
+                                                   noiseTextures.occupancy);
+    }
+    noiseTextures.resolution = noiseSampleResolution;
+    if (gpuNoise) {
+        detailTextures.gradEncoding = generateNoiseOnGpu(detailNoise,
+                                                         detailSampleResolution,
+                                                         detailStorage,
+                                                         detailTextures.noise,
+                                                         0, 0);
+    } else {
+        detailTextures.gradEncoding = generateNoise(detailNoise,
+                                                    detailSampleResolution,
+                                                    detailStorage,
+                                                    detailTextures.noise,
+                                                    0, 0);
+    }
+    detailTextures.resolution = detailSampleResolution;
 
-    generateHeightGradient(heightTexHeight,
-                           heightTexResolution,
-                           heightTex, heightGradTex);
+    heightOccupied = generateHeightGradient(heightTexHeight,
+                                            heightTexResolution,
+                                            heightTex, heightGradTex);
+    invalidateLightVolume();
 }
 
 void setFarPlane(float far) {
@@ -92,54 +213,57 @@ void setFarPlane(float far) {
 }
 
 void defineSlicePlanes(float far) {
+    farPlane = far;
+    float distance = sliceDistance;
+    if (temporalAccumulation)
+        distance *= temporalSliceSpacing;
+    sliceLayout = {distance, sliceGrowth};
+    numSlices = sliceLayout.count(far);
+
     // If OpenGL has not been initialized, do nothing
     if (!initialized)
         return;
 
-    std::vector<GLfloat> data;
-    numQuads = 0;
-
-    int numSlices = far / sliceDistance - 1;
-    for (int i = 0; i < numSlices; i++) {
-        // If you shrink this value, a border should appear.
-        float size = 1;
-        float z = -i * sliceDistance;
-        addVector(data,  size,  size, z);
-        addVector(data, -size,  size, z);
-        addVector(data, -size, -size, z);
-        addVector(data,  size,  size, z);
-        addVector(data, -size, -size, z);
-        addVector(data,  size, -size, z);
-        numQuads++;
-    }
-
-    glBindBuffer(GL_ARRAY_BUFFER, sliceVBO);
-    glBufferData(GL_ARRAY_BUFFER,
-                 data.size() * sizeof(GLfloat),
-                 data.data(),
-                 GL_STATIC_DRAW);
-
-    // Initialize VAO
-    glBindVertexArray(sliceVAO);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0,
-                          3,
-                          GL_FLOAT,
-                          GL_FALSE,
-                          0,
-                          nullptr);
-    glBindVertexArray(0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-
     glUseProgram(cloudProgram);
-    glUniform1f(glGetUniformLocation(cloudProgram, "layerDensity"),
-                sliceDistance);
+    glUniform1f(glGetUniformLocation(cloudProgram, "sliceDistance"),
+                sliceLayout.spacing);
+    glUniform1f(glGetUniformLocation(cloudProgram, "sliceGrowth"),
+                sliceLayout.growth);
     glUseProgram(0);
 }
 
+void generateNoise() {
+    resetSparseVolume();
+    if (!gpuNoise) {
+        streamNoise(shapeNoise, noiseSampleResolution, noiseStorage);
+        return;
+    }
+    // Quick enough not to need streaming
+    noiseTextures.gradEncoding = generateNoiseOnGpu(shapeNoise,
+                                                    noiseSampleResolution,
+                                                    noiseStorage,
+                                                    noiseTextures.noise,
+                                                    noiseTextures.fade,
+                                                    noiseTextures.occupancy);
+    noiseTextures.resolution = noiseSampleResolution;
+    invalidateLightVolume();
+}
+
+void setNoiseResolution(int resolution) {
+    resolution = glm::max(resolution, 1);
+    if (resolution == noiseSampleResolution)
+        return;
+    noiseSampleResolution = resolution;
+    if (initialized)
+        generateNoise();
+}
+
 void advanceTime(float time) {
-    // Not implemented
+    cloudTime += time;
+    noiseAnimation = animateNoise(cloudTime);
+    // The light volume follows the wind between rebuilds, but not the rest
+    // of the motion, so keep rebuilding it
+    expireLightVolume();
 }
 
 void updateCameraUniforms();
@@ -149,79 +273,528 @@ void setCamera(const Camera &newCamera) {
     updateCameraUniforms();
 }
 
+void setRenderMode(RenderMode mode) {
+    renderMode = mode;
+}
+
+void setResolutionDivisor(int divisor) {
+    resolutionDivisor = glm::max(divisor, 1);
+}
+
+void setTemporalAccumulation(bool enabled) {
+    if (enabled == temporalAccumulation)
+        return;
+    temporalAccumulation = enabled;
+    defineSlicePlanes(farPlane);
+    if (initialized)
+        resetTemporal();
+}
+
+void setSliceOrder(SliceOrder order) {
+    sliceOrder = order;
+}
+
+void setLightDirection(glm::vec3 direction) {
+    if (glm::length(direction) == 0)
+        return;
+    direction = glm::normalize(direction);
+    if (direction == lightDirection)
+        return;
+    lightDirection = direction;
+    invalidateLightVolume();
+}
+
+void setPrecomputedLighting(bool enabled) {
+    precomputedLighting = enabled;
+}
+
 void updateCameraUniforms() {
     if (!initialized)
         return;
 
-    glUseProgram(cloudProgram);
-
     glm::mat4 viewMatrix = camera->getViewMatrix();
     glm::mat4 invViewMatrix = glm::inverse(viewMatrix);
     glm::mat4 projMatrix = camera->getPerspectiveMatrix();
     glm::mat4 invProjMatrix = glm::inverse(projMatrix);
-    glUniform3fv(glGetUniformLocation(cloudProgram, "cameraPos"),
-                 1,
-                 &camera->pos[0]);
-    glUniformMatrix4fv(glGetUniformLocation(cloudProgram, "viewMatrix"),
-                       1,
-                       GL_FALSE,
-                       &viewMatrix[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(cloudProgram, "invViewMatrix"),
-                       1,
-                       GL_FALSE,
-                       &invViewMatrix[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(cloudProgram, "projMatrix"),
-                       1,
-                       GL_FALSE,
-                       &projMatrix[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(cloudProgram, "invProjMatrix"),
-                       1,
-                       GL_FALSE,
-                       &invProjMatrix[0][0]);
+
+    for (GLuint program : {cloudProgram, marchProgram, halfAngleProgram}) {
+        glUseProgram(program);
+        glUniform3fv(glGetUniformLocation(program, "cameraPos"),
+                     1,
+                     &camera->pos[0]);
+        glUniformMatrix4fv(glGetUniformLocation(program, "viewMatrix"),
+                           1,
+                           GL_FALSE,
+                           &viewMatrix[0][0]);
+        glUniformMatrix4fv(glGetUniformLocation(program, "invViewMatrix"),
+                           1,
+                           GL_FALSE,
+                           &invViewMatrix[0][0]);
+        glUniformMatrix4fv(glGetUniformLocation(program, "projMatrix"),
+                           1,
+                           GL_FALSE,
+                           &projMatrix[0][0]);
+        glUniformMatrix4fv(glGetUniformLocation(program, "invProjMatrix"),
+                           1,
+                           GL_FALSE,
+                           &invProjMatrix[0][0]);
+    }
 
     glUseProgram(0);
 }
 
-void renderClouds() {
-    glUseProgram(cloudProgram);
+// Binds the textures and sets the uniforms shared by every cloud program
+void bindCloudInputs(GLuint program) {
+    glUseProgram(program);
 
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_3D, noiseTex);
-    glUniform1i(glGetUniformLocation(cloudProgram, "noiseTex"), 0);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_3D, noiseGradTex);
-    glUniform1i(glGetUniformLocation(cloudProgram, "noiseGradTex"), 1);
-    glUniform3fv(glGetUniformLocation(cloudProgram, "noiseSampleScale"),
+    glBindTexture(GL_TEXTURE_3D, noiseTextures.noise);
+    glUniform1i(glGetUniformLocation(program, "noiseTex"), 0);
+    glActiveTexture(GL_TEXTURE12);
+    glBindTexture(GL_TEXTURE_3D, noiseTextures.fade);
+    glUniform1i(glGetUniformLocation(program, "noiseFadeTex"), 12);
+    glUniform3fv(glGetUniformLocation(program, "noiseSampleScale"),
                  1, &noiseSampleScale[0]);
+    setNoiseAnimationUniforms(program, noiseAnimation);
+    glUniform1f(glGetUniformLocation(program, "noiseGradScale"),
+                noiseTextures.gradEncoding.scale);
+    glUniform1f(glGetUniformLocation(program, "noiseGradBias"),
+                noiseTextures.gradEncoding.bias);
+
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_3D, detailTextures.noise);
+    glUniform1i(glGetUniformLocation(program, "detailTex"), 9);
+    glUniform1f(glGetUniformLocation(program, "detailGradScale"),
+                detailTextures.gradEncoding.scale);
+    glUniform1f(glGetUniformLocation(program, "detailGradBias"),
+                detailTextures.gradEncoding.bias);
+    glUniform1f(glGetUniformLocation(program, "detailRepeat"), detailRepeat);
+    glUniform1f(glGetUniformLocation(program, "detailFade"), detailFade);
+    // Near the camera, the shape comes from the sparse volume's bricks
+    bindSparseVolume(program, noiseAnimation, 1, 10, 11);
+    bindCoverage(program, noiseAnimation, 13);
+
+    glUniform3fv(glGetUniformLocation(program, "cloudColor"),
+                 1, &cloudColor[0]);
 
     glActiveTexture(GL_TEXTURE2);
     glBindTexture(GL_TEXTURE_1D, heightTex);
-    glUniform1i(glGetUniformLocation(cloudProgram, "heightTex"), 2);
+    glUniform1i(glGetUniformLocation(program, "heightTex"), 2);
     glActiveTexture(GL_TEXTURE3);
     glBindTexture(GL_TEXTURE_1D, heightGradTex);
-    glUniform1i(glGetUniformLocation(cloudProgram, "heightGradTex"), 3);
-    glUniform1f(glGetUniformLocation(cloudProgram, "startHeight"),
+    glUniform1i(glGetUniformLocation(program, "heightGradTex"), 3);
+    glUniform1f(glGetUniformLocation(program, "startHeight"),
                  startHeight);
-    glUniform1ui(glGetUniformLocation(cloudProgram, "heightTexHeight"),
+    glUniform1ui(glGetUniformLocation(program, "heightTexHeight"),
                  heightTexHeight);
+}
+
+// Unbinds every unit bindCloudInputs binds
+void unbindCloudInputs() {
+    glActiveTexture(GL_TEXTURE13);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE12);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE11);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE10);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
 
+// Binds the inputs that cloud.frag uses to skip work, after buildTileDepth
+void bindSliceInputs(GLuint program) {
+    // Fragments outside the occupied heights, or in bricks of noise that
+    // are empty, are discarded before sampling the noise
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_3D, noiseTextures.occupancy);
+    glUniform1i(glGetUniformLocation(program, "occupancyTex"), 5);
+    glUniform1f(glGetUniformLocation(program, "noiseResolution"),
+                noiseTextures.resolution);
+    // Mip level up to which a brick's range covers the filter footprint
+    glUniform1f(glGetUniformLocation(program, "occupancyMaxLod"),
+                glm::log2(occupancyMargin + 1.f) - 1);
+    glUniform2fv(glGetUniformLocation(program, "heightOccupied"),
+                 1, &heightOccupied[0]);
+
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, tileDepth());
+    glUniform1i(glGetUniformLocation(program, "tileDepth"), 6);
+
+    // Where renderHalfAngle binds the light buffer. Samplers of different
+    // types must not share a unit, even if unused.
+    glUniform1i(glGetUniformLocation(program, "lightBuffer"), 7);
+}
+
+// Binds the precomputed light volume for cloud.frag or cloud_march.frag,
+// if it is enabled and built
+void bindLightVolume(GLuint program) {
+    bool lit = precomputedLighting && lightVolumeReady();
+    glUniform1i(glGetUniformLocation(program, "lit"), lit);
+    glUniform1i(glGetUniformLocation(program, "lightVolume"), 8);
+    if (!lit)
+        return;
+    glActiveTexture(GL_TEXTURE8);
+    glBindTexture(GL_TEXTURE_3D, lightVolume());
+    // Move the volume with the clouds since it was built. Offsets wrap, and
+    // the drift since then is the shorter way round.
+    glm::vec3 drift = noiseAnimation.offset - lightVolumeNoiseOffset();
+    drift -= glm::round(drift);
+    glm::vec3 origin = lightVolumeOrigin() - drift * noiseSampleScale;
+    glm::vec3 size = lightVolumeSize();
+    glUniform3fv(glGetUniformLocation(program, "lightVolumeOrigin"),
+                 1, &origin[0]);
+    glUniform3fv(glGetUniformLocation(program, "lightVolumeSize"),
+                 1, &size[0]);
+    glUniform1f(glGetUniformLocation(program, "cloudAmbient"), cloudAmbient);
+}
+
+void unbindLightVolume() {
+    glActiveTexture(GL_TEXTURE8);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void unbindSliceInputs() {
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+// Draws against targetDepth, the depth texture of the targetSize target
+void renderSlices(GLuint targetDepth, glm::ivec2 targetSize) {
+    // Only the slices that cross the cloud layer. Jittered samples lie up to
+    // one spacing in front of their slice, so keep the one behind as well.
+    glm::ivec2 slices = visibleSlices(*camera, sliceLayout, numSlices,
+                                      heightOccupied);
+    if (temporalAccumulation)
+        slices.y = glm::min(slices.y + 1, numSlices - 1);
+    if (slices.x > slices.y)
+        return;
+
+    // Slices are drawn in tiles, and skip those where the scene is nearer
+    int tileSize = occlusionTileSize > 0 ? occlusionTileSize
+                                         : glm::max(targetSize.x, targetSize.y);
+    glm::ivec2 tiles = buildTileDepth(targetDepth, targetSize, tileSize);
+
+    bindCloudInputs(cloudProgram);
+    bindSliceInputs(cloudProgram);
+    bindLightVolume(cloudProgram);
+    glUniform1i(glGetUniformLocation(cloudProgram, "farthestSlice"),
+                slices.y);
+
+    // Spread each frame's samples across the spacing between slices
+    glUniform1i(glGetUniformLocation(cloudProgram, "jittered"),
+                temporalAccumulation);
+    glUniform1f(glGetUniformLocation(cloudProgram, "frameJitter"),
+                temporalAccumulation ? temporalJitter() : 0);
+
+    // Slices are depth tested against the scene, but must not occlude each
+    // other or anything drawn after them
+    glDepthMask(GL_FALSE);
     glBindVertexArray(sliceVAO);
-    // Render back to front
-    for (int i = numQuads - 1; i >= 0; i--) {
-        // First, render the slice into the light buffer
+    int tileVertices = 6 * tiles.x * tiles.y;
+
+    if (sliceOrder == SliceOrder::BackToFront) {
+        // Blend each slice over the ones behind it. One instance per slice,
+        // ordered back to front by cloud.vert. Instances are rasterized in
+        // order, so they blend in that order.
+        glUniform1i(glGetUniformLocation(cloudProgram, "frontToBack"), false);
+        glUniform1i(glGetUniformLocation(cloudProgram, "premultiplied"), false);
         glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
                             GL_ONE,       GL_ONE_MINUS_SRC_ALPHA);
+        glDrawArraysInstanced(GL_TRIANGLES, 0, tileVertices,
+                              slices.y - slices.x + 1);
+    } else {
+        // Blend each slice (premultiplied) under the ones in front of it:
+        // the destination's alpha is their opacity, so the new slice is
+        // weighted by their transmittance 1 - alpha. The target is one of
+        // lowres.h's, whose stencil marks the pixels that are already opaque.
+        glUniform1i(glGetUniformLocation(cloudProgram, "frontToBack"), true);
+        glUniform1i(glGetUniformLocation(cloudProgram, "premultiplied"), true);
+        glBlendFunc(GL_ONE_MINUS_DST_ALPHA, GL_ONE);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+        for (int first = slices.x; first <= slices.y;
+             first += saturationInterval) {
+            int count = glm::min(saturationInterval, slices.y - first + 1);
+            glUniform1i(glGetUniformLocation(cloudProgram, "nearestSlice"),
+                        first);
+            glEnable(GL_STENCIL_TEST);
+            glStencilFunc(GL_EQUAL, 0, 0xff);
+            glDrawArraysInstanced(GL_TRIANGLES, 0, tileVertices, count);
+            glDisable(GL_STENCIL_TEST);
+
+            if (first + count <= slices.y) {
+                markSaturated(saturationAlpha);
+                glUseProgram(cloudProgram);
+                glBindVertexArray(sliceVAO);
+            }
+        }
+    }
+
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    unbindLightVolume();
+    unbindSliceInputs();
+}
+
+// Draws half-angle slices against targetDepth, the depth texture of the
+// targetSize target, alternating between the target and the light buffer:
+// each slice is shaded by the light buffer, then added to it.
+void renderHalfAngle(GLuint targetDepth, glm::ivec2 targetSize) {
+    float spacing = halfAngleSliceDistance;
+    if (temporalAccumulation)
+        spacing *= temporalSliceSpacing;
+    HalfAngleLayout layout = halfAngleSlices(*camera, farPlane, lightDirection,
+                                             spacing, heightOccupied);
+    if (layout.count == 0)
+        return;
 
-        // Then, render the slice into the eye buffer
-        // glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
-        //                     GL_ONE_MINUS_DST_ALPHA, GL_ONE);
-        glDrawArrays(GL_TRIANGLES, 6 * i, 6);
+    GLint targetFBO;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &targetFBO);
+    LightView light = beginLightBuffer(lightDirection,
+                                       cloudBounds(heightOccupied),
+                                       lightBufferResolution);
+
+    int tileSize = occlusionTileSize > 0 ? occlusionTileSize
+                                         : glm::max(targetSize.x, targetSize.y);
+    glm::ivec2 tiles = buildTileDepth(targetDepth, targetSize, tileSize);
+
+    // The light pass samples the noise at about a light buffer texel
+    float lightTexel = glm::length(light.right) / lightBufferResolution;
+    float noiseTexel = glm::min(noiseSampleScale.x,
+                                glm::min(noiseSampleScale.y, noiseSampleScale.z))
+            / noiseTextures.resolution;
+    bindCloudInputs(lightProgram);
+    glUniform3fv(glGetUniformLocation(lightProgram, "lightOrigin"),
+                 1, &light.origin[0]);
+    glUniform3fv(glGetUniformLocation(lightProgram, "lightRight"),
+                 1, &light.right[0]);
+    glUniform3fv(glGetUniformLocation(lightProgram, "lightUp"),
+                 1, &light.up[0]);
+    glUniform3fv(glGetUniformLocation(lightProgram, "lightDir"),
+                 1, &lightDirection[0]);
+    glUniform3fv(glGetUniformLocation(lightProgram, "sliceAxis"),
+                 1, &layout.axis[0]);
+    glUniform1f(glGetUniformLocation(lightProgram, "lightStep"),
+                layout.spacing / glm::dot(layout.axis, lightDirection));
+    glUniform1f(glGetUniformLocation(lightProgram, "noiseLod"),
+                glm::max(glm::log2(lightTexel / noiseTexel), 0.f));
+    glUniform2fv(glGetUniformLocation(lightProgram, "heightOccupied"),
+                 1, &heightOccupied[0]);
+
+    bindCloudInputs(halfAngleProgram);
+    bindSliceInputs(halfAngleProgram);
+    glUniform3fv(glGetUniformLocation(halfAngleProgram, "sliceAxis"),
+                 1, &layout.axis[0]);
+    glUniform1f(glGetUniformLocation(halfAngleProgram, "sliceStep"),
+                layout.spacing);
+    // The nearest slices along the view are at least this far apart
+    glUniform1f(glGetUniformLocation(halfAngleProgram, "sliceDistance"),
+                layout.spacing);
+    glUniform1i(glGetUniformLocation(halfAngleProgram, "premultiplied"), true);
+    glUniform1i(glGetUniformLocation(halfAngleProgram, "jittered"),
+                temporalAccumulation);
+    glUniform1f(glGetUniformLocation(halfAngleProgram, "frameJitter"),
+                temporalAccumulation ? temporalJitter() : 0);
+    glUniform1i(glGetUniformLocation(halfAngleProgram, "shadowed"), true);
+    glUniform1f(glGetUniformLocation(halfAngleProgram, "cloudAmbient"),
+                cloudAmbient);
+    glUniformMatrix4fv(glGetUniformLocation(halfAngleProgram, "lightMatrix"),
+                       1, GL_FALSE, &light.worldToTexture[0][0]);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_2D, lightBuffer());
+
+    // Premultiplied slices go under the ones drawn before them if the
+    // camera sees them front to back, or else over them. The target is one
+    // of lowres.h's, which has alpha to blend under.
+    GLenum eyeSrc = layout.frontToBack ? GL_ONE_MINUS_DST_ALPHA : GL_ONE;
+    GLenum eyeDst = layout.frontToBack ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA;
+
+    glDepthMask(GL_FALSE);
+    glBindVertexArray(sliceVAO);
+    for (int k = 0; k < layout.count; k++) {
+        float plane = layout.first + k * layout.spacing;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+        glViewport(0, 0, targetSize.x, targetSize.y);
+        glUseProgram(halfAngleProgram);
+        glUniform1f(glGetUniformLocation(halfAngleProgram, "slicePlane"),
+                    plane);
+        glBlendFunc(eyeSrc, eyeDst);
+        glDrawArrays(GL_TRIANGLES, 0, 6 * tiles.x * tiles.y);
+
+        bindLightBuffer();
+        glUseProgram(lightProgram);
+        glUniform1f(glGetUniformLocation(lightProgram, "slicePlane"), plane);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
     }
     glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_1D, 0);
-    glBindTexture(GL_TEXTURE_3D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+    glViewport(0, 0, targetSize.x, targetSize.y);
+    glActiveTexture(GL_TEXTURE7);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    unbindSliceInputs();
+}
+
+// Copies the depth buffer of the bound framebuffer, inside viewport, into
+// depthTex. The framebuffer's depth format must be GL_DEPTH24_STENCIL8.
+void copySceneDepth(glm::ivec4 viewport) {
+    GLint sceneFBO;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &sceneFBO);
+
+    glm::ivec2 size(viewport[2], viewport[3]);
+    if (size != depthSize) {
+        glBindTexture(GL_TEXTURE_2D, depthTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, size.x, size.y, 0,
+                     GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                               GL_TEXTURE_2D, depthTex, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        depthSize = size;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneFBO);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFBO);
+    glBlitFramebuffer(viewport[0], viewport[1],
+                      viewport[0] + size.x, viewport[1] + size.y,
+                      0, 0, size.x, size.y,
+                      GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+}
+
+// Marches up to sceneDepth, into a target viewportHeight pixels high
+void renderRayMarched(GLuint sceneDepth, int viewportHeight) {
+    bindCloudInputs(marchProgram);
+    bindLightVolume(marchProgram);
+
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    glUniform1i(glGetUniformLocation(marchProgram, "sceneDepth"), 4);
+
+    // A pixel at distance t covers t * pixelAngle world units; pick the mip
+    // whose texels (along the most finely sampled axis) are that size
+    float pixelAngle = 2 * glm::tan(camera->heightAngle / 2) / viewportHeight;
+    float texelSize = glm::min(noiseSampleScale.x,
+                               glm::min(noiseSampleScale.y, noiseSampleScale.z))
+            / noiseTextures.resolution;
+    glUniform1f(glGetUniformLocation(marchProgram, "noiseLodScale"),
+                pixelAngle / texelSize);
+    float detailTexelSize = texelSize * noiseTextures.resolution
+            / (detailRepeat * detailTextures.resolution);
+    glUniform1f(glGetUniformLocation(marchProgram, "detailLodScale"),
+                pixelAngle / detailTexelSize);
+
+    glUniform1f(glGetUniformLocation(marchProgram, "cloudFloorStart"),
+                cloudFloorStart);
+    glUniform1f(glGetUniformLocation(marchProgram, "cloudCeilEnd"),
+                cloudCeilEnd);
+    glUniform1f(glGetUniformLocation(marchProgram, "emptyStep"),
+                marchEmptyStep);
+    glUniform1f(glGetUniformLocation(marchProgram, "denseStep"),
+                marchDenseStep);
+    glUniform1f(glGetUniformLocation(marchProgram, "minTransmittance"),
+                marchMinTransmittance);
+    glUniform1i(glGetUniformLocation(marchProgram, "maxSteps"),
+                marchMaxSteps);
+
+    // The shader outputs premultiplied color, and handles occlusion itself
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+
+    glBindVertexArray(sliceVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glEnable(GL_DEPTH_TEST);
+    unbindLightVolume();
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void renderClouds() {
+    glm::ivec4 viewport;
+    glGetIntegerv(GL_VIEWPORT, &viewport[0]);
+    GLint sceneFBO;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &sceneFBO);
+
+    // Regenerated noise replaces the noise in use once it is all uploaded
+    if (updateNoiseStream(noiseUploadBudget, noiseTextures)) {
+        invalidateLightVolume();
+    }
+    // Bricks come and go as the camera moves, changing the clouds a little
+    if (updateSparseVolume(camera->pos, noiseAnimation, heightOccupied,
+                           noiseUploadBudget)) {
+        expireLightVolume();
+    }
+    updateCoverage(noiseAnimation);
+
+    // Half-angle slices have their own lighting
+    if (precomputedLighting && renderMode != RenderMode::HalfAngle) {
+        updateLightVolume(noiseTextures.noise, noiseTextures.fade,
+                          noiseTextures.resolution, heightTex, heightOccupied,
+                          lightDirection, noiseAnimation,
+                          lightVolumeLayersPerFrame);
+    }
+
+    // Temporal accumulation, front-to-back and half-angle slices also draw
+    // into the low-resolution target, at full resolution if the divisor is 1
+    bool frontToBack = renderMode == RenderMode::Slices
+            && sliceOrder == SliceOrder::FrontToBack;
+    bool halfAngle = renderMode == RenderMode::HalfAngle;
+    bool offscreen = resolutionDivisor > 1 || temporalAccumulation
+            || frontToBack || halfAngle;
+    copySceneDepth(viewport);
+
+    // Depth the clouds are drawn against, and the size of their target
+    GLuint targetDepth = depthTex;
+    glm::ivec2 targetSize(viewport[2], viewport[3]);
+    if (offscreen) {
+        // Blending under a nearly opaque destination needs more precision
+        // than 8 bits to add up hundreds of thin slices
+        targetSize = beginLowRes(viewport, resolutionDivisor, depthTex,
+                                 frontToBack || halfAngle ? GL_RGBA16F
+                                                          : GL_RGBA8);
+        targetDepth = lowResDepth();
+    }
+
+    if (renderMode == RenderMode::RayMarch) {
+        renderRayMarched(targetDepth, targetSize.y);
+    } else if (renderMode == RenderMode::HalfAngle) {
+        renderHalfAngle(targetDepth, targetSize);
+    } else {
+        renderSlices(targetDepth, targetSize);
+    }
+
+    if (offscreen) {
+        GLuint cloudTex = lowResColor();
+        if (temporalAccumulation) {
+            glm::mat4 viewProj = camera->getPerspectiveMatrix()
+                    * camera->getViewMatrix();
+            cloudTex = resolveTemporal(cloudTex, targetDepth, targetSize,
+                                       viewProj);
+        }
+        compositeLowRes(sceneFBO, viewport, cloudTex, depthTex,
+                        camera->getPerspectiveMatrix());
+    }
+
+    unbindCloudInputs();
     glUseProgram(0);
 }
 
@@ -3,12 +3,47 @@
 #include <camera.h>
 
 namespace cloud {
+    // How renderClouds() draws the clouds
+    enum class RenderMode {
+        Slices,    // view-aligned slices, blended back to front
+        RayMarch,  // one ray per pixel through the cloud layer, up to the scene depth
+        HalfAngle, // slices halfway between the view and the light,
+                   // shadowed by the slices nearer the light
+    };
+
+    // Order in which RenderMode::Slices draws the slices
+    enum class SliceOrder {
+        BackToFront, // each slice over the ones behind it
+        FrontToBack, // each slice under the ones in front of it, skipping
+                     // pixels they have already made opaque
+    };
+
     void initializeClouds();
     void finalizeClouds();
 
     void setFarPlane(float far);
     void setCamera(const Camera &camera);
+    void setRenderMode(RenderMode mode);
+    // Draws the clouds at 1 / divisor of the scene's resolution, and
+    // upsamples them onto it
+    void setResolutionDivisor(int divisor);
+    // Draws sparser slices, shifted a little every frame, and blends the
+    // frames together over time
+    void setTemporalAccumulation(bool enabled);
+    void setSliceOrder(SliceOrder order);
+    // Direction a directional light travels, for RenderMode::HalfAngle
+    void setLightDirection(glm::vec3 direction);
+    // Shades the clouds by their transmittance towards the light, from a
+    // volume precomputed when the light or the clouds change. Half-angle
+    // slices shade themselves instead.
+    void setPrecomputedLighting(bool enabled);
+    // Regenerates the noise from the parameters in params.h, in the
+    // background. The current noise is drawn until the new noise is ready.
     void generateNoise();
+    // Regenerates the noise at resolution samples a side, if that changes it
+    void setNoiseResolution(int resolution);
+    // Moves the clouds on by time seconds: they drift with the wind, warp and
+    // slowly change shape. Only changes uniforms.
     void advanceTime(float time);
     void renderClouds();
 }
@@ -0,0 +1,277 @@
+#include "coverage.h"
+
+#include <vector>
+
+#include <utils/shaderloader.h>
+
+#include "noise/perlin_impl.h"
+#include "params.h"
+
+namespace cloud {
+
+GLuint coverageTex;
+GLuint coverageProgram;
+GLuint coverageFBO;
+GLuint coverageVAO;
+
+// The gradient table, as 1D textures for coverageProgram
+GLuint coveragePermTex;
+GLuint coverageGradientTex;
+
+// Texel of the map's first row and column, counted in the clouds' frame
+// from where the texel grid starts. Texel k is stored at k modulo the
+// resolution.
+glm::ivec2 coverageMin;
+bool coverageValid = false;
+
+const noise::GradientTable &coverageGradients() {
+    static const noise::GradientTable table = noise::GradientTable::make2D(2);
+    return table;
+}
+
+// The cloud type's fbm, hashed apart from the coverage's
+noise::Fbm cloudTypeNoise() {
+    noise::Fbm fbm = coverageNoise;
+    fbm.firstOctave += fbm.octaves;
+    return fbm;
+}
+
+float coverageTexelSize() {
+    return coverageMapSize / coverageResolution;
+}
+
+// Floored modulo, for texels at negative coordinates
+int coverageStorage(int texel) {
+    return (texel % coverageResolution + coverageResolution) % coverageResolution;
+}
+
+void initializeCoverage() {
+    int n = coverageResolution;
+    glGenTextures(1, &coverageTex);
+    glBindTexture(GL_TEXTURE_2D, coverageTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, n, n, 0, GL_RG, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    coverageProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_coverage.frag");
+    glGenFramebuffers(1, &coverageFBO);
+    glGenVertexArrays(1, &coverageVAO);
+
+    const noise::GradientTable &table = coverageGradients();
+    std::vector<glm::vec2> gradients(table.size);
+    for (int i = 0; i < table.size; i++) {
+        gradients[i] = glm::vec2(table.gx[i], table.gy[i]);
+    }
+    // Looked up with texelFetch only
+    glGenTextures(1, &coveragePermTex);
+    glBindTexture(GL_TEXTURE_1D, coveragePermTex);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_R32I, table.perm.size(), 0,
+                 GL_RED_INTEGER, GL_INT, table.perm.data());
+    glGenTextures(1, &coverageGradientTex);
+    glBindTexture(GL_TEXTURE_1D, coverageGradientTex);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RG32F, table.size, 0,
+                 GL_RG, GL_FLOAT, gradients.data());
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    coverageValid = false;
+}
+
+void finalizeCoverage() {
+    glDeleteTextures(1, &coverageGradientTex);
+    glDeleteTextures(1, &coveragePermTex);
+    glDeleteVertexArrays(1, &coverageVAO);
+    glDeleteFramebuffers(1, &coverageFBO);
+    glDeleteProgram(coverageProgram);
+    glDeleteTextures(1, &coverageTex);
+}
+
+// Generates texels [begin, end), which must not wrap around the texture,
+// on the CPU
+void generateCoverageRect(glm::ivec2 begin, glm::ivec2 end) {
+    glm::ivec2 size = end - begin;
+    size_t count = size_t(size.x) * size.y;
+    float t = coverageTexelSize();
+    std::vector<float> x(count), z(count), cover(count), type(count);
+    size_t i = 0;
+    for (int row = begin.y; row < end.y; row++) {
+        for (int column = begin.x; column < end.x; column++, i++) {
+            x[i] = (column + 0.5f) * t;
+            z[i] = (row + 0.5f) * t;
+        }
+    }
+    const noise::GradientTable &table = coverageGradients();
+    noise::fbm2(table, coverageNoise, x.data(), z.data(), cover.data(), count);
+    noise::fbm2(table, cloudTypeNoise(), x.data(), z.data(), type.data(), count);
+
+    // As floats, which GL converts as it would the GPU's output. Rows of
+    // them also need no unpack alignment.
+    std::vector<glm::vec2> texels(count);
+    for (i = 0; i < count; i++) {
+        glm::vec2 value(coverageAmount + coverageContrast * cover[i],
+                        cloudTypeAmount + cloudTypeContrast * type[i]);
+        texels[i] = glm::clamp(value, 0.f, 1.f);
+    }
+    glBindTexture(GL_TEXTURE_2D, coverageTex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0,
+                    coverageStorage(begin.x), coverageStorage(begin.y),
+                    size.x, size.y, GL_RG, GL_FLOAT, texels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// The same, rendered by coverageProgram into the map, which is attached to
+// the bound framebuffer
+void renderCoverageRect(glm::ivec2 begin, glm::ivec2 end) {
+    glm::ivec2 storage(coverageStorage(begin.x), coverageStorage(begin.y));
+    glm::ivec2 size = end - begin;
+    glViewport(storage.x, storage.y, size.x, size.y);
+    glm::ivec2 offset = begin - storage;
+    glUniform2iv(glGetUniformLocation(coverageProgram, "texelOffset"), 1, &offset[0]);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+// Octaves of fbm for coverageProgram: (frequency, amplitude, period, offset)
+void setCoverageOctaves(const char *name, const noise::Fbm &fbm) {
+    noise::detail::Octave octaves[noise::detail::maxOctaves];
+    int numOctaves = noise::detail::resolveOctaves(fbm, octaves);
+    std::vector<glm::vec4> octaveData(numOctaves);
+    for (int i = 0; i < numOctaves; i++) {
+        octaveData[i] = glm::vec4(octaves[i].frequency, octaves[i].amplitude,
+                                  octaves[i].period, octaves[i].offset);
+    }
+    glUniform4fv(glGetUniformLocation(coverageProgram, name),
+                 numOctaves, &octaveData[0][0]);
+    glUniform1i(glGetUniformLocation(coverageProgram, "numOctaves"), numOctaves);
+}
+
+// Generates texels [begin, end), at most a map across, split where they wrap
+// around the texture
+void generateCoverage(glm::ivec2 begin, glm::ivec2 end) {
+    if (begin.x >= end.x || begin.y >= end.y)
+        return;
+    int n = coverageResolution;
+
+    GLint prevFBO;
+    glm::ivec4 prevViewport;
+    GLboolean blend = GL_FALSE;
+    GLboolean depthTest = GL_FALSE;
+    if (gpuNoise) {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFBO);
+        glGetIntegerv(GL_VIEWPORT, &prevViewport[0]);
+        blend = glIsEnabled(GL_BLEND);
+        depthTest = glIsEnabled(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, coverageFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, coverageTex, 0);
+        glBindVertexArray(coverageVAO);
+
+        glUseProgram(coverageProgram);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_1D, coveragePermTex);
+        glUniform1i(glGetUniformLocation(coverageProgram, "permTex"), 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_1D, coverageGradientTex);
+        glUniform1i(glGetUniformLocation(coverageProgram, "gradientTex"), 1);
+        setCoverageOctaves("coverageOctaves", coverageNoise);
+        setCoverageOctaves("typeOctaves", cloudTypeNoise());
+        glUniform1f(glGetUniformLocation(coverageProgram, "texelSize"),
+                    coverageTexelSize());
+        glUniform2f(glGetUniformLocation(coverageProgram, "amount"),
+                    coverageAmount, cloudTypeAmount);
+        glUniform2f(glGetUniformLocation(coverageProgram, "contrast"),
+                    coverageContrast, cloudTypeContrast);
+    }
+
+    for (int x = begin.x; x < end.x;) {
+        int xEnd = glm::min(end.x, x + n - coverageStorage(x));
+        for (int z = begin.y; z < end.y;) {
+            int zEnd = glm::min(end.y, z + n - coverageStorage(z));
+            if (gpuNoise)
+                renderCoverageRect(glm::ivec2(x, z), glm::ivec2(xEnd, zEnd));
+            else
+                generateCoverageRect(glm::ivec2(x, z), glm::ivec2(xEnd, zEnd));
+            z = zEnd;
+        }
+        x = xEnd;
+    }
+
+    if (gpuNoise) {
+        glBindTexture(GL_TEXTURE_1D, 0);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_1D, 0);
+        glUseProgram(0);
+        glBindVertexArray(0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, 0, 0);
+        if (blend)
+            glEnable(GL_BLEND);
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+        glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+    }
+}
+
+// Where the clouds' frame has moved the y axis, in world units
+glm::dvec2 coverageDrift(const NoiseAnimation &animation) {
+    glm::dvec3 drift = animation.drift * glm::dvec3(noiseSampleScale);
+    return glm::dvec2(drift.x, drift.z);
+}
+
+void updateCoverage(const NoiseAnimation &animation) {
+    if (!coverageMap)
+        return;
+    // Centered on the y axis, where the layer is
+    int n = coverageResolution;
+    glm::ivec2 newMin = glm::ivec2(glm::floor(coverageDrift(animation)
+                                              / double(coverageTexelSize()))) - n / 2;
+    glm::ivec2 moved = newMin - coverageMin;
+    if (!coverageValid || glm::abs(moved.x) >= n || glm::abs(moved.y) >= n) {
+        generateCoverage(newMin, newMin + n);
+    } else {
+        // Columns that have come in, then rows, all of the new map across
+        if (moved.x > 0)
+            generateCoverage(glm::ivec2(coverageMin.x + n, newMin.y), newMin + n);
+        else if (moved.x < 0)
+            generateCoverage(newMin, glm::ivec2(coverageMin.x, newMin.y + n));
+        if (moved.y > 0)
+            generateCoverage(glm::ivec2(newMin.x, coverageMin.y + n), newMin + n);
+        else if (moved.y < 0)
+            generateCoverage(newMin, glm::ivec2(newMin.x + n, coverageMin.y));
+    }
+    coverageMin = newMin;
+    coverageValid = true;
+}
+
+void bindCoverage(GLuint program, const NoiseAnimation &animation, int unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, coverageTex);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(glGetUniformLocation(program, "coverageTex"), unit);
+    bool covered = coverageMap && coverageValid;
+    glUniform1i(glGetUniformLocation(program, "covered"), covered);
+    if (!covered)
+        return;
+    // Texture coordinates repeat every map, so the drift is only needed
+    // modulo that, which keeps it precise in a float
+    glm::dvec2 shift = glm::mod(coverageDrift(animation), double(coverageMapSize));
+    glUniform2f(glGetUniformLocation(program, "coverageShift"),
+                float(shift.x), float(shift.y));
+    glUniform1f(glGetUniformLocation(program, "coverageMapSize"), coverageMapSize);
+    glUniform1f(glGetUniformLocation(program, "coverageTexelSize"),
+                coverageTexelSize());
+    glUniform1f(glGetUniformLocation(program, "cloudFloor"), cloudFloorStart);
+    glUniform1f(glGetUniformLocation(program, "flatCloudHeight"), flatCloudHeight);
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "animation.h"
+
+namespace cloud {
+// A 2D map of where the clouds are, over the xz plane: their coverage in
+// red and their type in green, generated from coverageNoise. It drifts with
+// the wind as the noise does. The texture wraps around, so as the map
+// scrolls, only the rows and columns that come into it are generated, on
+// the CPU or, with gpuNoise set, on the GPU. The shaders look it up before
+// the 3D noise, and skip the noise where the coverage is 0.
+
+void initializeCoverage();
+void finalizeCoverage();
+
+// Scrolls the map to where animation has moved the clouds, generating the
+// texels that come into it. Does nothing unless coverageMap is set.
+void updateCoverage(const NoiseAnimation &animation);
+
+// Binds the map to texture unit unit, and sets the uniforms of the program
+// in use for the clouds as animation moves them
+void bindCoverage(GLuint program, const NoiseAnimation &animation, int unit);
+}
@@ -0,0 +1,248 @@
+#include "gpunoise.h"
+
+#include <utils/shaderloader.h>
+
+#include "noise/perlin_impl.h"
+#include "params.h"
+
+namespace cloud {
+
+GLuint noiseSampleProgram;
+GLuint noiseEncodeProgram;
+GLuint noiseOccupancyProgram;
+GLuint noiseDownsampleProgram;
+GLuint noiseFBO;
+GLuint noiseVAO;
+
+// The gradient table, as 1D textures
+GLuint permTex;
+GLuint gradientTableTex;
+
+void initializeGpuNoise() {
+    noiseSampleProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_noise.frag");
+    noiseEncodeProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_noiseencode.frag");
+    noiseOccupancyProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_noiseoccupancy.frag");
+    noiseDownsampleProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_noisedownsample.frag");
+    glGenFramebuffers(1, &noiseFBO);
+    glGenVertexArrays(1, &noiseVAO);
+
+    const noise::GradientTable &table = noiseGradients();
+    std::vector<glm::vec3> gradients(table.size);
+    for (int i = 0; i < table.size; i++) {
+        gradients[i] = glm::vec3(table.gx[i], table.gy[i], table.gz[i]);
+    }
+
+    // Looked up with texelFetch only
+    glGenTextures(1, &permTex);
+    glBindTexture(GL_TEXTURE_1D, permTex);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_R32I, table.perm.size(), 0,
+                 GL_RED_INTEGER, GL_INT, table.perm.data());
+    glGenTextures(1, &gradientTableTex);
+    glBindTexture(GL_TEXTURE_1D, gradientTableTex);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB32F, table.size, 0,
+                 GL_RGB, GL_FLOAT, gradients.data());
+    glBindTexture(GL_TEXTURE_1D, 0);
+}
+
+void finalizeGpuNoise() {
+    glDeleteTextures(1, &gradientTableTex);
+    glDeleteTextures(1, &permTex);
+    glDeleteVertexArrays(1, &noiseVAO);
+    glDeleteFramebuffers(1, &noiseFBO);
+    glDeleteProgram(noiseDownsampleProgram);
+    glDeleteProgram(noiseOccupancyProgram);
+    glDeleteProgram(noiseEncodeProgram);
+    glDeleteProgram(noiseSampleProgram);
+}
+
+// Draws one full-screen triangle into each layer of level of the
+// attached textures, setting the program's "layer" uniform
+void drawLayers(GLuint program, const GLuint *textures, int numTextures,
+                int level, int size) {
+    glViewport(0, 0, size, size);
+    GLint layerLoc = glGetUniformLocation(program, "layer");
+    for (int layer = 0; layer < size; layer++) {
+        for (int i = 0; i < numTextures; i++) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
+                                      textures[i], level, layer);
+        }
+        glUniform1i(layerLoc, layer);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    for (int i = 0; i < numTextures; i++) {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i,
+                                  0, 0, 0);
+    }
+}
+
+GradientEncoding generateNoiseOnGpu(const noise::Fbm &fbm,
+                                    unsigned int sampleResolution,
+                                    NoiseStorage storage,
+                                    GLuint noiseTex, GLuint fadeTex,
+                                    GLuint occupancyTex) {
+    int n = sampleResolution;
+    int m = occupancyResolution(n);
+    int levels = noiseLevels(n);
+
+    noise::detail::Octave octaves[noise::detail::maxOctaves];
+    int numOctaves = noise::detail::resolveOctaves(fbm, octaves);
+
+    GLint prevFBO;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFBO);
+    glm::ivec4 prevViewport;
+    glGetIntegerv(GL_VIEWPORT, &prevViewport[0]);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, noiseFBO);
+    glBindVertexArray(noiseVAO);
+
+    // The fbm samples and their gradients, which the rest is derived from
+    GLuint samplesTex;
+    glGenTextures(1, &samplesTex);
+    glBindTexture(GL_TEXTURE_3D, samplesTex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA32F, n, n, n, 0, GL_RGBA, GL_FLOAT, nullptr);
+
+    glBindTexture(GL_TEXTURE_3D, noiseTex);
+    for (int level = 0; level < levels; level++) {
+        int size = noiseLevelResolution(n, level);
+        glTexImage3D(GL_TEXTURE_3D, level, noiseFormat(storage),
+                     size, size, size, 0, GL_RGBA, GL_FLOAT, nullptr);
+    }
+    if (fadeTex) {
+        glBindTexture(GL_TEXTURE_3D, fadeTex);
+        for (int level = 0; level < levels; level++) {
+            int size = noiseLevelResolution(n, level);
+            glTexImage3D(GL_TEXTURE_3D, level, fadeFormat(storage),
+                         size, size, size, 0, GL_RED, GL_FLOAT, nullptr);
+        }
+    }
+    if (occupancyTex) {
+        glBindTexture(GL_TEXTURE_3D, occupancyTex);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_RG32F, m, m, m, 0, GL_RG, GL_FLOAT, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    // Samples
+    std::vector<glm::vec4> octaveData(numOctaves);
+    for (int i = 0; i < numOctaves; i++) {
+        octaveData[i] = glm::vec4(octaves[i].frequency, octaves[i].amplitude,
+                                  octaves[i].period, octaves[i].offset);
+    }
+    glUseProgram(noiseSampleProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_1D, permTex);
+    glUniform1i(glGetUniformLocation(noiseSampleProgram, "permTex"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, gradientTableTex);
+    glUniform1i(glGetUniformLocation(noiseSampleProgram, "gradientTex"), 1);
+    glUniform1i(glGetUniformLocation(noiseSampleProgram, "resolution"), n);
+    glUniform4fv(glGetUniformLocation(noiseSampleProgram, "octaves"),
+                 numOctaves, &octaveData[0][0]);
+    glUniform1i(glGetUniformLocation(noiseSampleProgram, "numOctaves"), numOctaves);
+    drawLayers(noiseSampleProgram, &samplesTex, 1, 0, n);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_1D, 0);
+
+    // Occupancy, and the range of the gradient per brick. Without an
+    // occupancy texture, the first target is left empty and not written.
+    GLenum drawBuffers[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, drawBuffers);
+    GLuint rangeTex;
+    glGenTextures(1, &rangeTex);
+    glBindTexture(GL_TEXTURE_3D, rangeTex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R32F, m, m, m, 0, GL_RED, GL_FLOAT, nullptr);
+    GLuint occupancyTargets[] = {occupancyTex, rangeTex};
+    glUseProgram(noiseOccupancyProgram);
+    glBindTexture(GL_TEXTURE_3D, samplesTex);
+    glUniform1i(glGetUniformLocation(noiseOccupancyProgram, "samplesTex"), 0);
+    glUniform1i(glGetUniformLocation(noiseOccupancyProgram, "resolution"), n);
+    glUniform1i(glGetUniformLocation(noiseOccupancyProgram, "bricks"), m);
+    glUniform1i(glGetUniformLocation(noiseOccupancyProgram, "margin"), occupancyMargin);
+    drawLayers(noiseOccupancyProgram, occupancyTargets, 2, 0, m);
+
+    GradientEncoding encoding;
+    if (storage == NoiseStorage::Unorm) {
+        // Map [-range, range] to [0, 1], as encodeSamples does. This reads
+        // back a value per brick, not per sample.
+        std::vector<float> ranges(m * m * m);
+        glBindTexture(GL_TEXTURE_3D, rangeTex);
+        glGetTexImage(GL_TEXTURE_3D, 0, GL_RED, GL_FLOAT, ranges.data());
+        float range = 1e-6f;
+        for (float r : ranges) {
+            range = glm::max(range, r);
+        }
+        encoding.scale = 2 * range;
+        encoding.bias = -range;
+    }
+    glDeleteTextures(1, &rangeTex);
+
+    // Level 0 of the noise, and of the fade texture. Without a fade
+    // texture, the second target is left empty and not written.
+    GLuint encodeTargets[] = {noiseTex, fadeTex};
+    glUseProgram(noiseEncodeProgram);
+    glBindTexture(GL_TEXTURE_3D, samplesTex);
+    glUniform1i(glGetUniformLocation(noiseEncodeProgram, "samplesTex"), 0);
+    glUniform1i(glGetUniformLocation(noiseEncodeProgram, "resolution"), n);
+    glUniform1f(glGetUniformLocation(noiseEncodeProgram, "gradientScale"),
+                1 / encoding.scale);
+    glUniform1f(glGetUniformLocation(noiseEncodeProgram, "gradientBias"),
+                -encoding.bias / encoding.scale);
+    drawLayers(noiseEncodeProgram, encodeTargets, 2, 0, n);
+    glDrawBuffers(1, drawBuffers);
+
+    // Mipmaps, each level from the one above. Only that level is in the
+    // texture's range while it is read, so that writing the next one is not
+    // a feedback loop.
+    glUseProgram(noiseDownsampleProgram);
+    glUniform1i(glGetUniformLocation(noiseDownsampleProgram, "noiseTex"), 0);
+    for (GLuint tex : encodeTargets) {
+        if (!tex)
+            continue;
+        glBindTexture(GL_TEXTURE_3D, tex);
+        for (int level = 1; level < levels; level++) {
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_BASE_LEVEL, level - 1);
+            glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, level - 1);
+            glUniform1i(glGetUniformLocation(noiseDownsampleProgram, "size"),
+                        noiseLevelResolution(n, level - 1));
+            drawLayers(noiseDownsampleProgram, &tex, 1, level,
+                       noiseLevelResolution(n, level));
+        }
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 1000);
+    }
+
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glDeleteTextures(1, &samplesTex);
+
+    glBindVertexArray(0);
+    glUseProgram(0);
+    if (blend)
+        glEnable(GL_BLEND);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+
+    return encoding;
+}
+
+}
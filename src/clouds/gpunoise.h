@@ -0,0 +1,23 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "noise.h"
+
+namespace cloud {
+// Generates the noise textures on the GPU. The fbm samples and their
+// gradients are rendered into a 3D texture one z layer per draw, from the
+// same gradient table as the CPU uses, and the noise and fade textures,
+// occupancy and mipmaps are derived from them by further layer draws, each
+// as the CPU derives them. The results match generateNoise up to float rounding.
+
+void initializeGpuNoise();
+void finalizeGpuNoise();
+
+// As generateNoise. Keeps the bound framebuffer and viewport.
+GradientEncoding generateNoiseOnGpu(
+        const noise::Fbm &fbm,
+        unsigned int sampleResolution,
+        NoiseStorage storage,
+        GLuint noiseTex, GLuint fadeTex, GLuint occupancyTex);
+}
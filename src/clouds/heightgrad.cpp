@@ -16,7 +16,7 @@ void computeGradients(unsigned int height,
                       const std::vector<GLfloat> &densities,
                       std::vector<GLfloat> &gradients);
 
-void generateHeightGradient(
+glm::vec2 generateHeightGradient(
         int height, float resolution,
         GLuint densityTex, GLuint gradTex) {
     int numSteps = height * resolution;
@@ -52,6 +52,18 @@ void generateHeightGradient(
                  gradients.data());
     glBindTexture(GL_TEXTURE_1D, 0);
 
+    // Samples i and j are the first and last nonzero ones. Filtering blends
+    // sample i with the one below it, whose center is at (i - 0.5) /
+    // resolution. At the ends of the texture it wraps, so give up there.
+    int i = 0;
+    while (i < numSteps && densities[i] <= 0) i++;
+    int j = numSteps - 1;
+    while (j >= 0 && densities[j] <= 0) j--;
+    if (i > j)
+        return glm::vec2(1, 0);
+    if (i == 0 || j == numSteps - 1)
+        return glm::vec2(0, height);
+    return glm::vec2(i - 0.5f, j + 1.5f) / resolution;
 }
 
 void computeDensities(unsigned int height, float resolution,
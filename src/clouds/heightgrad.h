@@ -2,8 +2,11 @@
 
 #include <GL/glew.h>
 #include <GL/gl.h>
+#include <glm/glm.hpp>
 
 namespace cloud {
-void generateHeightGradient(int height, float resolution,
+// Returns the heights between which the (linearly filtered) density can be
+// nonzero. The range is empty (x > y) if the density is zero everywhere.
+glm::vec2 generateHeightGradient(int height, float resolution,
         GLuint densityTex, GLuint gradTex);
 }
@@ -0,0 +1,83 @@
+#include "lightbuffer.h"
+
+namespace cloud {
+
+GLuint lightFBO;
+GLuint lightTex;
+int lightResolution = 0;
+
+void initializeLightBuffer() {
+    glGenTextures(1, &lightTex);
+    glBindTexture(GL_TEXTURE_2D, lightTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &lightFBO);
+    lightResolution = 0;
+}
+
+void finalizeLightBuffer() {
+    glDeleteFramebuffers(1, &lightFBO);
+    glDeleteTextures(1, &lightTex);
+}
+
+LightView beginLightBuffer(glm::vec3 lightDir, glm::vec4 bounds,
+                           int resolution) {
+    GLint prevFBO;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFBO);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFBO);
+    if (resolution != lightResolution) {
+        // Hundreds of thin slices add up in it, which 8 bits cannot hold
+        glBindTexture(GL_TEXTURE_2D, lightTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, resolution, resolution, 0,
+                     GL_RED, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, lightTex, 0);
+        lightResolution = resolution;
+    }
+    const GLfloat clear[4] = {0, 0, 0, 0};
+    glClearBufferfv(GL_COLOR, 0, clear);
+    glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+
+    // Any basis across the light
+    glm::vec3 forward = glm::normalize(lightDir);
+    glm::vec3 other = glm::abs(forward.y) < 0.99f ? glm::vec3(0, 1, 0)
+                                                  : glm::vec3(1, 0, 0);
+    glm::vec3 right = glm::normalize(glm::cross(forward, other));
+    glm::vec3 up = glm::cross(right, forward);
+
+    glm::vec3 center(bounds);
+    float size = 2 * bounds.w;
+    LightView view;
+    view.origin = center - (right + up) * bounds.w;
+    view.right = right * size;
+    view.up = up * size;
+    // s = dot(right, x - origin) / size, and likewise t
+    view.worldToTexture = glm::mat4(1);
+    for (int i = 0; i < 3; i++) {
+        view.worldToTexture[i][0] = right[i] / size;
+        view.worldToTexture[i][1] = up[i] / size;
+        view.worldToTexture[i][2] = 0;
+    }
+    view.worldToTexture[3][0] = -glm::dot(right, view.origin) / size;
+    view.worldToTexture[3][1] = -glm::dot(up, view.origin) / size;
+    view.worldToTexture[3][2] = 0;
+    return view;
+}
+
+void bindLightBuffer() {
+    glBindFramebuffer(GL_FRAMEBUFFER, lightFBO);
+    glViewport(0, 0, lightResolution, lightResolution);
+}
+
+GLuint lightBuffer() {
+    return lightTex;
+}
+
+}
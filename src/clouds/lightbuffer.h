@@ -0,0 +1,36 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace cloud {
+// Opacity of the clouds as seen from a directional light, accumulated one
+// half-angle slice at a time, so that each slice can be shaded by the ones
+// between it and the light.
+
+void initializeLightBuffer();
+void finalizeLightBuffer();
+
+// Where the buffer lies: texture coordinates (s, t) are the light ray
+// through origin + s * right + t * up, and worldToTexture takes a point to
+// its (s, t) in xy
+struct LightView {
+    glm::vec3 origin;
+    glm::vec3 right;
+    glm::vec3 up;
+    glm::mat4 worldToTexture;
+};
+
+// Clears a buffer resolution texels wide, seen along lightDir and covering
+// the sphere bounds (xyz center, w radius). Keeps the bound framebuffer and
+// viewport.
+LightView beginLightBuffer(glm::vec3 lightDir, glm::vec4 bounds,
+                           int resolution);
+
+// Binds the buffer and sets the viewport to it, for drawing a slice's
+// opacity with glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_COLOR)
+void bindLightBuffer();
+
+// Single-channel opacity texture, filtered linearly
+GLuint lightBuffer();
+}
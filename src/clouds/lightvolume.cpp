@@ -0,0 +1,217 @@
+#include "lightvolume.h"
+
+#include <utils/shaderloader.h>
+
+#include "coverage.h"
+#include "params.h"
+#include "slicerange.h"
+#include "sparsevolume.h"
+
+namespace cloud {
+
+GLuint volumeProgram;
+GLuint volumeFBO;
+GLuint volumeVAO;
+
+// The volume in use, and the one being rebuilt
+struct Volume {
+    GLuint tex;
+    glm::vec3 origin;
+    glm::vec3 size;
+    glm::vec3 noiseOffset;
+};
+Volume volumes[2];
+int shownVolume = 0;
+bool volumeReady = false;
+
+// Progress of the rebuild: the next layer, or -1 if the volume is up to date
+int nextLayer = -1;
+glm::vec3 buildLightDir;
+glm::vec2 buildHeightRange;
+NoiseAnimation buildAnimation;
+
+void initializeLightVolume() {
+    volumeProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_lightvolume.frag");
+
+    for (Volume &volume : volumes) {
+        glGenTextures(1, &volume.tex);
+        glBindTexture(GL_TEXTURE_3D, volume.tex);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexImage3D(GL_TEXTURE_3D, 0, GL_R8,
+                     lightVolumeResolution.x, lightVolumeResolution.y,
+                     lightVolumeResolution.z, 0, GL_RED, GL_UNSIGNED_BYTE,
+                     nullptr);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    glGenFramebuffers(1, &volumeFBO);
+    glGenVertexArrays(1, &volumeVAO);
+    shownVolume = 0;
+    volumeReady = false;
+    nextLayer = -1;
+}
+
+void finalizeLightVolume() {
+    glDeleteVertexArrays(1, &volumeVAO);
+    glDeleteFramebuffers(1, &volumeFBO);
+    for (Volume &volume : volumes) {
+        glDeleteTextures(1, &volume.tex);
+    }
+    glDeleteProgram(volumeProgram);
+}
+
+void invalidateLightVolume() {
+    // Start over, even if a rebuild is under way
+    nextLayer = 0;
+}
+
+void expireLightVolume() {
+    if (nextLayer < 0)
+        nextLayer = 0;
+}
+
+void updateLightVolume(GLuint noiseTex, GLuint fadeTex, int noiseResolution,
+                       GLuint heightTex, glm::vec2 heightRange,
+                       glm::vec3 lightDir, const NoiseAnimation &animation,
+                       int maxLayers) {
+    if (nextLayer < 0)
+        return;
+
+    Volume &volume = volumes[volumeReady ? 1 - shownVolume : shownVolume];
+    if (nextLayer == 0) {
+        // The box around cloudBounds' sphere, with the sphere's bottom
+        // raised to startHeight, where density starts
+        buildLightDir = glm::normalize(lightDir);
+        buildHeightRange = heightRange;
+        // Every layer samples the clouds as they were when the build started
+        buildAnimation = animation;
+        volume.noiseOffset = animation.offset;
+        glm::vec4 bounds = cloudBounds(heightRange);
+        float bottom = startHeight;
+        float top = startHeight + glm::max(heightRange.y, 0.f);
+        volume.origin = glm::vec3(bounds.x - bounds.w, bottom,
+                                  bounds.z - bounds.w);
+        volume.size = glm::vec3(2 * bounds.w, glm::max(top - bottom, 1e-3f),
+                                2 * bounds.w);
+    }
+    if (!volumeReady)
+        maxLayers = lightVolumeResolution.z;
+
+    GLint prevFBO;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFBO);
+    glm::ivec4 prevViewport;
+    glGetIntegerv(GL_VIEWPORT, &prevViewport[0]);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+
+    glUseProgram(volumeProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, noiseTex);
+    glUniform1i(glGetUniformLocation(volumeProgram, "noiseTex"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, heightTex);
+    glUniform1i(glGetUniformLocation(volumeProgram, "heightTex"), 1);
+    glUniform3fv(glGetUniformLocation(volumeProgram, "noiseSampleScale"),
+                 1, &noiseSampleScale[0]);
+    setNoiseAnimationUniforms(volumeProgram, buildAnimation);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, fadeTex);
+    glUniform1i(glGetUniformLocation(volumeProgram, "noiseFadeTex"), 2);
+    bindSparseVolume(volumeProgram, buildAnimation, 3, 4, 5);
+    bindCoverage(volumeProgram, buildAnimation, 6);
+    glUniform1f(glGetUniformLocation(volumeProgram, "startHeight"),
+                startHeight);
+    glUniform1ui(glGetUniformLocation(volumeProgram, "heightTexHeight"),
+                 heightTexHeight);
+    glUniform2fv(glGetUniformLocation(volumeProgram, "heightOccupied"),
+                 1, &buildHeightRange[0]);
+    glUniform3fv(glGetUniformLocation(volumeProgram, "lightDir"),
+                 1, &buildLightDir[0]);
+    glUniform3fv(glGetUniformLocation(volumeProgram, "volumeOrigin"),
+                 1, &volume.origin[0]);
+    glUniform3fv(glGetUniformLocation(volumeProgram, "volumeSize"),
+                 1, &volume.size[0]);
+    glUniform1i(glGetUniformLocation(volumeProgram, "layers"),
+                lightVolumeResolution.z);
+
+    // Steps about a voxel long, sampling the noise at about that size
+    glm::vec3 voxel = volume.size / glm::vec3(lightVolumeResolution);
+    float step = glm::min(voxel.x, glm::min(voxel.y, voxel.z));
+    float noiseTexel = glm::min(noiseSampleScale.x,
+                                glm::min(noiseSampleScale.y, noiseSampleScale.z))
+            / noiseResolution;
+    glUniform1f(glGetUniformLocation(volumeProgram, "stepLength"), step);
+    glUniform1f(glGetUniformLocation(volumeProgram, "noiseLod"),
+                glm::max(glm::log2(step / noiseTexel), 0.f));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, volumeFBO);
+    glViewport(0, 0, lightVolumeResolution.x, lightVolumeResolution.y);
+    glBindVertexArray(volumeVAO);
+    int end = glm::min(nextLayer + maxLayers, lightVolumeResolution.z);
+    for (; nextLayer < end; nextLayer++) {
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                                  volume.tex, 0, nextLayer);
+        glUniform1i(glGetUniformLocation(volumeProgram, "layer"), nextLayer);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glBindVertexArray(0);
+
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_1D, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glUseProgram(0);
+
+    if (blend)
+        glEnable(GL_BLEND);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+
+    if (nextLayer == lightVolumeResolution.z) {
+        shownVolume = &volume - volumes;
+        volumeReady = true;
+        nextLayer = -1;
+    }
+}
+
+bool lightVolumeReady() {
+    return volumeReady;
+}
+
+GLuint lightVolume() {
+    return volumes[shownVolume].tex;
+}
+
+glm::vec3 lightVolumeOrigin() {
+    return volumes[shownVolume].origin;
+}
+
+glm::vec3 lightVolumeSize() {
+    return volumes[shownVolume].size;
+}
+
+glm::vec3 lightVolumeNoiseOffset() {
+    return volumes[shownVolume].noiseOffset;
+}
+
+}
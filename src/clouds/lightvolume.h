@@ -0,0 +1,42 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "animation.h"
+
+namespace cloud {
+// Transmittance from a directional light to every point of the cloud layer,
+// precomputed in a 3D texture, so that shading a sample costs one fetch.
+// Rebuilding it is spread over several frames, while the previous volume
+// stays in use.
+
+void initializeLightVolume();
+void finalizeLightVolume();
+
+// Marks the volume out of date, after the light or the clouds change
+void invalidateLightVolume();
+// Marks the volume out of date, without restarting a rebuild under way, for
+// clouds that change every frame
+void expireLightVolume();
+
+// Rebuilds up to maxLayers layers of an out-of-date volume from noiseTex and
+// its fadeTex, of noiseResolution samples a side, and heightTex, for the
+// cloud layer's heightRange (as in cloud_density.glsl), animated by
+// animation, and light travelling along lightDir. If there is no volume in
+// use yet, builds all of them. Keeps the bound framebuffer and viewport.
+void updateLightVolume(GLuint noiseTex, GLuint fadeTex, int noiseResolution,
+                       GLuint heightTex, glm::vec2 heightRange,
+                       glm::vec3 lightDir, const NoiseAnimation &animation,
+                       int maxLayers);
+
+// Whether there is a volume to use
+bool lightVolumeReady();
+// Single-channel transmittance texture, covering the box from origin to
+// origin + size: texture coordinates are (x - origin) / size
+GLuint lightVolume();
+glm::vec3 lightVolumeOrigin();
+glm::vec3 lightVolumeSize();
+// Noise offset of the animation the volume was built for
+glm::vec3 lightVolumeNoiseOffset();
+}
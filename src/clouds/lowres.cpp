@@ -0,0 +1,194 @@
+#include "lowres.h"
+
+#include <utils/shaderloader.h>
+
+namespace cloud {
+
+GLuint downsampleProgram;
+GLuint upsampleProgram;
+GLuint saturateProgram;
+
+GLuint lowResFBO;
+// The target's depth and stencil alone, for passes that read its color
+GLuint stencilFBO;
+GLuint lowResColorTex;
+GLuint lowResDepthTex;
+glm::ivec2 lowResSize(0);
+GLenum lowResFormat = GL_NONE;
+
+// Full-screen passes draw one triangle from gl_VertexID
+GLuint fullscreenVAO;
+
+void initializeLowRes() {
+    downsampleProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_downsample.frag");
+    upsampleProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_upsample.frag");
+    saturateProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_saturate.frag");
+
+    for (GLuint *tex : {&lowResColorTex, &lowResDepthTex}) {
+        glGenTextures(1, tex);
+        glBindTexture(GL_TEXTURE_2D, *tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &lowResFBO);
+    glGenFramebuffers(1, &stencilFBO);
+    glGenVertexArrays(1, &fullscreenVAO);
+    lowResSize = glm::ivec2(0);
+}
+
+void finalizeLowRes() {
+    glDeleteVertexArrays(1, &fullscreenVAO);
+    glDeleteFramebuffers(1, &stencilFBO);
+    glDeleteFramebuffers(1, &lowResFBO);
+    glDeleteTextures(1, &lowResDepthTex);
+    glDeleteTextures(1, &lowResColorTex);
+    glDeleteProgram(saturateProgram);
+    glDeleteProgram(upsampleProgram);
+    glDeleteProgram(downsampleProgram);
+}
+
+glm::ivec2 beginLowRes(glm::ivec4 viewport, int divisor, GLuint sceneDepth,
+                       GLenum colorFormat) {
+    glm::ivec2 size = (glm::ivec2(viewport[2], viewport[3]) + divisor - 1) / divisor;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, lowResFBO);
+    if (size != lowResSize || colorFormat != lowResFormat) {
+        glBindTexture(GL_TEXTURE_2D, lowResColorTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, colorFormat, size.x, size.y, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindTexture(GL_TEXTURE_2D, lowResDepthTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, size.x, size.y, 0,
+                     GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                               GL_TEXTURE_2D, lowResColorTex, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                               GL_TEXTURE_2D, lowResDepthTex, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, stencilFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
+                               GL_TEXTURE_2D, lowResDepthTex, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        glBindFramebuffer(GL_FRAMEBUFFER, lowResFBO);
+        lowResSize = size;
+        lowResFormat = colorFormat;
+    }
+    glViewport(0, 0, size.x, size.y);
+
+    const GLfloat transparent[4] = {0, 0, 0, 0};
+    glClearBufferfv(GL_COLOR, 0, transparent);
+    const GLint unmarked = 0;
+    glClearBufferiv(GL_STENCIL, 0, &unmarked);
+
+    // Write every texel's depth, and nothing else
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    glDepthFunc(GL_ALWAYS);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    glUseProgram(downsampleProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    glUniform1i(glGetUniformLocation(downsampleProgram, "sceneDepth"), 0);
+    glUniform2iv(glGetUniformLocation(downsampleProgram, "lowResSize"),
+                 1, &size[0]);
+    glBindVertexArray(fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(depthFunc);
+
+    return size;
+}
+
+void markSaturated(float saturationAlpha) {
+    glBindFramebuffer(GL_FRAMEBUFFER, stencilFBO);
+
+    // Only the stencil changes
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    GLboolean depthMask;
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+    glDepthFunc(GL_ALWAYS);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, 1, 0xff);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+    glUseProgram(saturateProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, lowResColorTex);
+    glUniform1i(glGetUniformLocation(saturateProgram, "cloudTex"), 0);
+    glUniform1f(glGetUniformLocation(saturateProgram, "saturationAlpha"),
+                saturationAlpha);
+    glBindVertexArray(fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glDisable(GL_STENCIL_TEST);
+    glDepthMask(depthMask);
+    glDepthFunc(depthFunc);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, lowResFBO);
+}
+
+GLuint lowResColor() {
+    return lowResColorTex;
+}
+
+GLuint lowResDepth() {
+    return lowResDepthTex;
+}
+
+void compositeLowRes(GLuint sceneFBO, glm::ivec4 viewport, GLuint colorTex,
+                     GLuint sceneDepth, const glm::mat4 &projMatrix) {
+    glBindFramebuffer(GL_FRAMEBUFFER, sceneFBO);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+    glUseProgram(upsampleProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colorTex);
+    glUniform1i(glGetUniformLocation(upsampleProgram, "cloudTex"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, lowResDepthTex);
+    glUniform1i(glGetUniformLocation(upsampleProgram, "cloudDepth"), 1);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    glUniform1i(glGetUniformLocation(upsampleProgram, "sceneDepth"), 2);
+    glUniform4f(glGetUniformLocation(upsampleProgram, "depthParams"),
+                projMatrix[2][2], projMatrix[3][2], projMatrix[2][3], projMatrix[3][3]);
+
+    // The target holds premultiplied color
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(fullscreenVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+
+    for (GLenum unit : {GL_TEXTURE2, GL_TEXTURE1, GL_TEXTURE0}) {
+        glActiveTexture(unit);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glUseProgram(0);
+}
+
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace cloud {
+// Off-screen target for drawing the clouds at a fraction of the scene's
+// resolution, and the passes that prepare and composite it.
+
+void initializeLowRes();
+void finalizeLowRes();
+
+// Binds a target 1 / divisor the size of viewport, clears it, and fills its
+// depth buffer from sceneDepth (the full-resolution depth of viewport).
+// Sets the viewport to the target and returns its size.
+glm::ivec2 beginLowRes(glm::ivec4 viewport, int divisor, GLuint sceneDepth,
+                       GLenum colorFormat = GL_RGBA8);
+
+// Sets the target's stencil to 1 where its alpha is at least
+// saturationAlpha. The target stays bound.
+void markSaturated(float saturationAlpha);
+
+// Color and depth textures of the target, for passes that read them
+GLuint lowResColor();
+GLuint lowResDepth();
+
+// Binds sceneFBO and viewport again and blends colorTex (the target, or a
+// texture of the same size derived from it) over it, with a depth-aware
+// upsample against sceneDepth
+void compositeLowRes(GLuint sceneFBO, glm::ivec4 viewport, GLuint colorTex,
+                     GLuint sceneDepth, const glm::mat4 &projMatrix);
+}
@@ -1,156 +1,265 @@
 #include "noise.h"
 
-#include <iostream>
+#include <utility>
 #include <vector>
 
 #include <glm/glm.hpp>
-#include <glm/gtc/random.hpp>
 
+#include "noise/volume.h"
 #include "params.h"
 
 namespace cloud {
 
+namespace {
+
 inline int getIndex(glm::ivec3 coord, int dimSize) {
-    glm::ivec3 wrapped = {
-        coord.x % dimSize,
-        coord.y % dimSize,
-        coord.z % dimSize
-    };
-    return ((wrapped[0] * dimSize) + wrapped[1]) * dimSize + wrapped[2];
-}
-
-void addGradient(
-        unsigned int noiseResolution,
-        unsigned int sampleResolution,
-        std::vector<glm::vec4> &texData,
-        std::vector<glm::vec3> &gradData);
-
-void generateNoise(
-        const std::vector<unsigned int> &noiseResolutions,
-        unsigned int sampleResolution,
-        GLuint noiseTex, GLuint gradTex) {
-    std::vector<glm::vec4> texData(sampleResolution * sampleResolution * sampleResolution);
-    // A gradient vector of the density
-    std::vector<glm::vec3> gradData(sampleResolution * sampleResolution * sampleResolution);
-
-    // Generate and sample noise of different resolutions
-    for (unsigned int noiseResolution : noiseResolutions) {
-        addGradient(noiseResolution, sampleResolution, texData, gradData);
-    }
+    glm::ivec3 wrapped = (coord % dimSize + dimSize) % dimSize;
+    return (wrapped.z * dimSize + wrapped.y) * dimSize + wrapped.x;
+}
 
-    // Pass noise texture
+// Averages each box of a resolution^3 volume into one sample of the next
+// level. Odd resolutions round down, as GL's do, and the last box of each
+// row takes the sample left over.
+template <typename T>
+std::vector<T> downsample(const std::vector<T> &volume, int resolution) {
+    int n = resolution;
+    int m = glm::max(n / 2, 1);
+    std::vector<T> result(m * m * m);
+    noise::forEachTile(m, [&](glm::ivec3 tileMin, glm::ivec3 tileMax) {
+        for (int z = tileMin.z; z < tileMax.z; z++) {
+        for (int y = tileMin.y; y < tileMax.y; y++) {
+        for (int x = tileMin.x; x < tileMax.x; x++) {
+            glm::ivec3 coord(x, y, z);
+            glm::ivec3 begin = coord * n / m;
+            glm::ivec3 end = (coord + 1) * n / m;
+            T sum(0);
+            for (int k = begin.z; k < end.z; k++) {
+            for (int j = begin.y; j < end.y; j++) {
+            for (int i = begin.x; i < end.x; i++) {
+                sum += volume[getIndex(glm::ivec3(i, j, k), n)];
+            }
+            }
+            }
+            glm::ivec3 count = end - begin;
+            result[getIndex(coord, m)] = sum / float(count.x * count.y * count.z);
+        }
+        }
+        }
+    });
+    return result;
+}
 
-    glBindTexture(GL_TEXTURE_3D, noiseTex);
-    glTexImage3D(GL_TEXTURE_3D,
-                 0, // level
-                 GL_RGBA, // internalformat
-                 sampleResolution,
-                 sampleResolution,
-                 sampleResolution,
-                 0, // border
-                 GL_RGBA, // format
-                 GL_FLOAT,
-                 texData.data());
-    glBindTexture(GL_TEXTURE_3D, 0);
+template <typename T>
+std::vector<std::vector<T>> mipmaps(std::vector<T> level, int resolution) {
+    std::vector<std::vector<T>> levels;
+    for (int n = resolution; n > 1; n /= 2) {
+        level = downsample(level, n);
+        levels.push_back(level);
+    }
+    return levels;
+}
 
-    glBindTexture(GL_TEXTURE_3D, gradTex);
-    glTexImage3D(GL_TEXTURE_3D,
-                 0, // level
-                 GL_RGB, // internalformat
-                 sampleResolution,
-                 sampleResolution,
-                 sampleResolution,
-                 0, // border
-                 GL_RGB, // format
-                 GL_FLOAT,
-                 gradData.data());
-    glBindTexture(GL_TEXTURE_3D, 0);
 }
 
-void initGradients(std::vector<glm::vec3> &gradients);
-void sampleGradients(const std::vector<glm::vec3> &gradients,
-                     unsigned int noiseResolution,
-                     unsigned int sampleResolution,
-                     std::vector<glm::vec4> &texData,
-                     std::vector<glm::vec3> &gradData);
+GLenum noiseFormat(NoiseStorage storage) {
+    switch (storage) {
+    case NoiseStorage::Unorm:
+        return GL_RGBA8;
+    case NoiseStorage::Half:
+        return GL_RGBA16F;
+    case NoiseStorage::Float:
+        break;
+    }
+    return GL_RGBA32F;
+}
 
-void addGradient(unsigned int noiseResolution,
-                 unsigned int sampleResolution,
-                 std::vector<glm::vec4> &texData,
-                 std::vector<glm::vec3> &gradData) {
+GLenum fadeFormat(NoiseStorage storage) {
+    switch (storage) {
+    case NoiseStorage::Unorm:
+        return GL_R8;
+    case NoiseStorage::Half:
+        return GL_R16F;
+    case NoiseStorage::Float:
+        break;
+    }
+    return GL_R32F;
+}
 
-    // Generate textureSize * textureSize vec4s
-    std::vector<glm::vec3> gradients(noiseResolution * noiseResolution * noiseResolution);
-    initGradients(gradients);
-    sampleGradients(gradients,
-                    noiseResolution,
-                    sampleResolution,
-                    texData,
-                    gradData);
+const noise::GradientTable &noiseGradients() {
+    static const noise::GradientTable table = noise::GradientTable::make3D(1);
+    return table;
 }
 
-void initGradients(std::vector<glm::vec3> &gradients) {
-    for (size_t i = 0; i < gradients.size(); i++) {
-        gradients[i] = glm::sphericalRand<GLfloat>(1);
+void generateSamples(const noise::Fbm &fbm, int sampleResolution,
+                     int zBegin, int zEnd, glm::vec4 *samples) {
+    // The gradient is of fbm over the unit cube, so per unit of texture
+    // coordinates, as the shaders use it
+    const noise::GradientTable &table = noiseGradients();
+    noise::forEachTile(sampleResolution, zBegin, zEnd,
+                       [&](glm::ivec3 tileMin, glm::ivec3 tileMax) {
+        noise::fbm3GradTile(table, fbm, sampleResolution, tileMin, tileMax,
+                            &samples[0].x);
+    });
+}
+
+GradientEncoding encodeSamples(std::vector<glm::vec4> &samples,
+                               NoiseStorage storage) {
+    GradientEncoding encoding;
+    if (storage == NoiseStorage::Unorm) {
+        // Map [-range, range] to [0, 1]
+        float range = 0;
+        for (const glm::vec4 &s : samples) {
+            range = glm::max(range, glm::max(glm::abs(s.x),
+                                             glm::max(glm::abs(s.y), glm::abs(s.z))));
+        }
+        range = glm::max(range, 1e-6f);
+        // Mipmaps average what the texture stores, as GL would, so the
+        // density is clamped here rather than by GL
+        for (glm::vec4 &s : samples) {
+            s = glm::vec4(glm::vec3(s) / (2 * range) + 0.5f,
+                          glm::clamp(s.w, 0.f, 1.f));
+        }
+        encoding.scale = 2 * range;
+        encoding.bias = -range;
     }
+    return encoding;
+}
+
+int noiseLevels(int sampleResolution) {
+    int levels = 1;
+    while (sampleResolution >> levels)
+        levels++;
+    return levels;
 }
 
-void sampleGradients(const std::vector<glm::vec3> &gradients,
-                     unsigned int noiseResolution,
-                     unsigned int sampleResolution,
-                     std::vector<glm::vec4> &texData,
-                     std::vector<glm::vec3> &gradData) {
-
-    assert(gradients.size() ==
-           noiseResolution * noiseResolution * noiseResolution);
-
-    // At each texture coordinate, sample the gradients and compute
-    //  (1) color
-    //  (2) density
-    //  (3) local gradient (points in direction of denser clouds)
-    for (unsigned int i1 = 0; i1 < sampleResolution; i1++) {
-    for (unsigned int i2 = 0; i2 < sampleResolution; i2++) {
-    for (unsigned int i3 = 0; i3 < sampleResolution; i3++) {
-        glm::ivec3 indexCoord(i1, i2, i3);
-        int index = getIndex(indexCoord, sampleResolution);
-
-        // Back-sampled coordinate, from 0.5 to sampleResolution - 0.5
-        glm::vec3 coord = (glm::vec3(indexCoord) + glm::vec3(0.5))
-                / ((float)sampleResolution);
-
-        // Scale coordinate to gradient pixel space
-        glm::vec3 gradientScaledCoord = coord * ((float)noiseResolution);
-        glm::ivec3 corner = glm::floor(gradientScaledCoord);
-        glm::vec3 offset = gradientScaledCoord - glm::vec3(corner);
-
-        float alpha = 0;
-        glm::vec3 localGrad(0);
-
-        // Sample gradient from each corner
-        for (int j1 = 0; j1 < 2; j1++) {
-        for (int j2 = 0; j2 < 2; j2++) {
-        for (int j3 = 0; j3 < 2; j3++) {
-            glm::ivec3 selectedCorner(j1, j2, j3);
-            glm::vec3 localOffset = offset - glm::vec3(selectedCorner);
-
-            glm::vec3 gradient = gradients[
-                    getIndex(corner + selectedCorner, noiseResolution)];
-            glm::vec3 nearness = glm::vec3(1) - glm::abs(localOffset);
-            float weight = nearness.x * nearness.y * nearness.z;
-
-            float dot = glm::dot(localOffset, gradient);
-            alpha += dot * weight;
-            localGrad += gradient * weight;
+int noiseLevelResolution(int sampleResolution, int level) {
+    return glm::max(sampleResolution >> level, 1);
+}
+
+std::vector<std::vector<glm::vec4>> noiseMipmaps(
+        const std::vector<glm::vec4> &samples, int sampleResolution) {
+    return mipmaps(samples, sampleResolution);
+}
+
+std::vector<float> fadeDensity(const std::vector<glm::vec4> &samples,
+                               int sampleResolution) {
+    int n = sampleResolution;
+    glm::ivec3 shift(n / 2);
+    std::vector<float> fade(samples.size());
+    noise::forEachTile(n, [&](glm::ivec3 tileMin, glm::ivec3 tileMax) {
+        for (int z = tileMin.z; z < tileMax.z; z++) {
+        for (int y = tileMin.y; y < tileMax.y; y++) {
+        for (int x = tileMin.x; x < tileMax.x; x++) {
+            glm::ivec3 coord(x, y, z);
+            fade[getIndex(coord, n)] = samples[getIndex(coord + shift, n)].w;
+        }
+        }
+        }
+    });
+    return fade;
+}
+
+std::vector<std::vector<float>> fadeMipmaps(const std::vector<float> &fade,
+                                            int sampleResolution) {
+    return mipmaps(fade, sampleResolution);
+}
+
+int occupancyResolution(int sampleResolution) {
+    return (sampleResolution + occupancyBrickSize - 1) / occupancyBrickSize;
+}
+
+std::vector<glm::vec2> generateOccupancy(const glm::vec4 *samples,
+                                         int sampleResolution) {
+    // Density range of each brick. Bricks cover equal fractions of the
+    // texture even if the resolution is not a multiple of the brick size.
+    int n = sampleResolution;
+    int m = occupancyResolution(n);
+    glm::ivec3 shift(n / 2);
+    std::vector<glm::vec2> occupancy(m * m * m);
+    noise::forEachTile(m, [&](glm::ivec3 tileMin, glm::ivec3 tileMax) {
+        for (int z = tileMin.z; z < tileMax.z; z++) {
+        for (int y = tileMin.y; y < tileMax.y; y++) {
+        for (int x = tileMin.x; x < tileMax.x; x++) {
+            glm::ivec3 brick(x, y, z);
+            glm::ivec3 begin = brick * n / m - occupancyMargin;
+            glm::ivec3 end = ((brick + 1) * n + m - 1) / m + occupancyMargin;
+            glm::vec2 range(samples[getIndex(begin, n)].w);
+            for (int k = begin.z; k < end.z; k++) {
+            for (int j = begin.y; j < end.y; j++) {
+            for (int i = begin.x; i < end.x; i++) {
+                glm::ivec3 coord(i, j, k);
+                float a = samples[getIndex(coord, n)].w;
+                float b = samples[getIndex(coord + shift, n)].w;
+                range = glm::vec2(glm::min(range.x, glm::min(a, b)),
+                                  glm::max(range.y, glm::max(a, b)));
+            }
+            }
+            }
+            occupancy[getIndex(brick, m)] = range;
         }
         }
         }
+    });
+    return occupancy;
+}
 
-        glm::vec3 color = glm::vec3(0.8);
-        texData[index] += glm::vec4(color, alpha) / (float) noiseResolution;
-        gradData[index] += localGrad / (float) noiseResolution * (float) sampleResolution;
+GradientEncoding generateNoise(const noise::Fbm &fbm,
+                               unsigned int sampleResolution,
+                               NoiseStorage storage,
+                               GLuint noiseTex, GLuint fadeTex,
+                               GLuint occupancyTex) {
+    int n = sampleResolution;
+    std::vector<glm::vec4> samples(n * n * n);
+    generateSamples(fbm, n, 0, n, samples.data());
+
+    if (occupancyTex) {
+        int m = occupancyResolution(n);
+        std::vector<glm::vec2> occupancy = generateOccupancy(samples.data(), n);
+        glBindTexture(GL_TEXTURE_3D, occupancyTex);
+        glTexImage3D(GL_TEXTURE_3D,
+                     0, // level
+                     GL_RG32F, // internalformat
+                     m, m, m,
+                     0, // border
+                     GL_RG, // format
+                     GL_FLOAT,
+                     occupancy.data());
+        glBindTexture(GL_TEXTURE_3D, 0);
     }
+
+    GradientEncoding encoding = encodeSamples(samples, storage);
+    if (fadeTex) {
+        std::vector<float> fade = fadeDensity(samples, n);
+        std::vector<std::vector<float>> fadeLevels = fadeMipmaps(fade, n);
+        fadeLevels.insert(fadeLevels.begin(), std::move(fade));
+        glBindTexture(GL_TEXTURE_3D, fadeTex);
+        for (int level = 0; level < noiseLevels(n); level++) {
+            int size = noiseLevelResolution(n, level);
+            glTexImage3D(GL_TEXTURE_3D, level, fadeFormat(storage),
+                         size, size, size, 0, GL_RED, GL_FLOAT,
+                         fadeLevels[level].data());
+        }
     }
+    std::vector<std::vector<glm::vec4>> levels = noiseMipmaps(samples, n);
+    levels.insert(levels.begin(), std::move(samples));
+
+    // Pass noise texture. GL converts the floats to the internal format.
+
+    glBindTexture(GL_TEXTURE_3D, noiseTex);
+    for (int level = 0; level < noiseLevels(n); level++) {
+        int size = noiseLevelResolution(n, level);
+        glTexImage3D(GL_TEXTURE_3D,
+                     level,
+                     noiseFormat(storage), // internalformat
+                     size, size, size,
+                     0, // border
+                     GL_RGBA, // format
+                     GL_FLOAT,
+                     levels[level].data());
     }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    return encoding;
 }
 
 }
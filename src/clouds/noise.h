@@ -1,11 +1,77 @@
 #pragma once
 
 #include <vector>
+
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "noise/perlin.h"
+#include "params.h"
 
 namespace cloud {
-void generateNoise(
-        const std::vector<unsigned int> &noiseResolutions,
+// How the shader turns a gradient texel back into a gradient:
+// texel * scale + bias
+struct GradientEncoding {
+    float scale = 1;
+    float bias = 0;
+};
+
+// Fills noiseTex (RGBA) with sampleResolution^3 samples of fbm over the
+// unit cube and their box-filtered mipmaps, in the format given by storage.
+// Each texel holds fbm's exact gradient, per unit of texture coordinates, in
+// RGB and its value, the density, in A, so one lookup gives both. fbm should
+// be periodic so that the texture tiles.
+//
+// Animated clouds fade from the noise into the same noise half the texture
+// away on every axis. Unless it is 0, fadeTex (single-channel, in the
+// density's format) is filled with that density, so that the fade costs one
+// small lookup rather than a second lookup of noiseTex.
+//
+// Also fills occupancyTex (RG32F), unless it is 0, with the minimum and
+// maximum density of each brick of occupancyBrickSize^3 samples, widened by
+// occupancyMargin samples on every side, over the noise and its shifted
+// copy, so that a filtered lookup anywhere in a brick with a maximum at or
+// below 0 returns at most 0.
+GradientEncoding generateNoise(
+        const noise::Fbm &fbm,
         unsigned int sampleResolution,
-        GLuint noiseTex, GLuint gradTex);
+        NoiseStorage storage,
+        GLuint noiseTex, GLuint fadeTex, GLuint occupancyTex);
+
+// The steps of generateNoise that run on the CPU, for generating the
+// texture a slab of z layers at a time. Volumes are stored as in
+// noise/volume.h.
+
+// Internal formats of the noise texture and the fade texture
+GLenum noiseFormat(NoiseStorage storage);
+GLenum fadeFormat(NoiseStorage storage);
+
+// The gradient table the noise is sampled with
+const noise::GradientTable &noiseGradients();
+// Samples fbm and its gradient at layers [zBegin, zEnd)
+void generateSamples(const noise::Fbm &fbm, int sampleResolution,
+                     int zBegin, int zEnd, glm::vec4 *samples);
+// Converts all the samples to storage's format, in place
+GradientEncoding encodeSamples(std::vector<glm::vec4> &samples,
+                               NoiseStorage storage);
+// Mipmap levels of a sampleResolution^3 volume, down to a single sample.
+// Level l has noiseLevelResolution(sampleResolution, l)^3 samples, as in GL.
+int noiseLevels(int sampleResolution);
+int noiseLevelResolution(int sampleResolution, int level);
+// Levels 1 and up of the (encoded) samples, averaged on the CPU, where GL
+// may be slow to generate 3D mipmaps
+std::vector<std::vector<glm::vec4>> noiseMipmaps(
+        const std::vector<glm::vec4> &samples, int sampleResolution);
+// The (encoded) density half the texture away from each sample, and its
+// mipmap levels 1 and up
+std::vector<float> fadeDensity(const std::vector<glm::vec4> &samples,
+                               int sampleResolution);
+std::vector<std::vector<float>> fadeMipmaps(const std::vector<float> &fade,
+                                            int sampleResolution);
+// Density range of each brick of the whole samples, and of the samples
+// half the texture away, of which there are
+// occupancyResolution(sampleResolution)^3
+int occupancyResolution(int sampleResolution);
+std::vector<glm::vec2> generateOccupancy(const glm::vec4 *samples,
+                                         int sampleResolution);
 }
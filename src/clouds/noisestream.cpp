@@ -0,0 +1,294 @@
+#include "noisestream.h"
+
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "noise/volume.h"
+#include "params.h"
+
+namespace cloud {
+
+// A slab of one level of one of the textures, ready to upload
+struct NoiseSlab {
+    enum Texture { Noise, Fade, Occupancy } texture;
+    int level;
+    int zBegin;
+    int zEnd;
+};
+
+// The noise being generated. The worker thread fills the arrays a slab at a
+// time, and queues each slab once it will not write it again.
+struct NoiseGeneration {
+    noise::Fbm fbm;
+    int resolution;
+    NoiseStorage storage;
+
+    // Mipmap levels of the samples, from the whole resolution down
+    std::vector<std::vector<glm::vec4>> samples;
+    std::vector<std::vector<float>> fade;
+    std::vector<glm::vec2> occupancy;
+    GradientEncoding gradEncoding;
+
+    std::mutex mutex;
+    std::deque<NoiseSlab> slabs;
+    bool generated = false;
+};
+
+// Textures being filled
+NoiseTextures streamTextures;
+
+// Pixel buffers, used in turn. Each one's fence is signalled once the upload
+// reading it is done.
+struct UploadBuffer {
+    GLuint buffer;
+    GLsync fence = nullptr;
+};
+std::vector<UploadBuffer> uploadBuffers;
+int nextUploadBuffer = 0;
+
+std::unique_ptr<NoiseGeneration> generation;
+// Declared after generation, so it is joined before generation is destroyed
+std::jthread generationThread;
+
+void queueSlab(NoiseGeneration &gen, NoiseSlab slab) {
+    std::lock_guard<std::mutex> lock(gen.mutex);
+    gen.slabs.push_back(slab);
+}
+
+void generateSlabs(std::stop_token stop, NoiseGeneration &gen) {
+    int n = gen.resolution;
+    std::vector<glm::vec4> &samples = gen.samples[0];
+
+    // Unorm gradients are encoded over the range of all of them, so those
+    // slabs wait for the rest. Other slabs go up as soon as they are done.
+    bool encoded = gen.storage == NoiseStorage::Unorm;
+    for (int z = 0; z < n; z += noise::tileSize) {
+        if (stop.stop_requested())
+            return;
+        int zEnd = glm::min(z + noise::tileSize, n);
+        generateSamples(gen.fbm, n, z, zEnd, samples.data());
+        if (!encoded)
+            queueSlab(gen, {NoiseSlab::Noise, 0, z, zEnd});
+    }
+
+    // Occupancy covers the samples half the texture away, so needs them all
+    if (stop.stop_requested())
+        return;
+    gen.occupancy = generateOccupancy(samples.data(), n);
+
+    if (encoded) {
+        gen.gradEncoding = encodeSamples(samples, gen.storage);
+        for (int z = 0; z < n; z += noise::tileSize) {
+            queueSlab(gen, {NoiseSlab::Noise, 0, z, glm::min(z + noise::tileSize, n)});
+        }
+    }
+    if (stop.stop_requested())
+        return;
+    std::vector<std::vector<glm::vec4>> levels = noiseMipmaps(samples, n);
+    std::move(levels.begin(), levels.end(), gen.samples.begin() + 1);
+    for (int level = 1; level < int(gen.samples.size()); level++) {
+        queueSlab(gen, {NoiseSlab::Noise, level, 0, noiseLevelResolution(n, level)});
+    }
+
+    // The fade density is also half the texture away, so needs all the
+    // (encoded) samples
+    if (stop.stop_requested())
+        return;
+    gen.fade[0] = fadeDensity(samples, n);
+    std::vector<std::vector<float>> fadeLevels = fadeMipmaps(gen.fade[0], n);
+    std::move(fadeLevels.begin(), fadeLevels.end(), gen.fade.begin() + 1);
+    for (int level = 0; level < int(gen.fade.size()); level++) {
+        int size = noiseLevelResolution(n, level);
+        for (int z = 0; z < size; z += noise::tileSize) {
+            queueSlab(gen, {NoiseSlab::Fade, level, z, glm::min(z + noise::tileSize, size)});
+        }
+    }
+    queueSlab(gen, {NoiseSlab::Occupancy, 0, 0, occupancyResolution(n)});
+
+    std::lock_guard<std::mutex> lock(gen.mutex);
+    gen.generated = true;
+}
+
+GLuint createNoiseTexture(GLenum minFilter) {
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_3D, tex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER,
+                    minFilter == GL_NEAREST ? GL_NEAREST : GL_LINEAR);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    return tex;
+}
+
+void initializeNoiseStream() {
+    streamTextures.noise = createNoiseTexture(GL_LINEAR_MIPMAP_LINEAR);
+    streamTextures.fade = createNoiseTexture(GL_LINEAR_MIPMAP_LINEAR);
+    streamTextures.occupancy = createNoiseTexture(GL_NEAREST);
+
+    uploadBuffers.resize(glm::max(noiseUploadBuffers, 1));
+    for (UploadBuffer &buffer : uploadBuffers) {
+        glGenBuffers(1, &buffer.buffer);
+    }
+    nextUploadBuffer = 0;
+}
+
+void finalizeNoiseStream() {
+    generationThread = std::jthread();
+    generation.reset();
+
+    for (UploadBuffer &buffer : uploadBuffers) {
+        if (buffer.fence)
+            glDeleteSync(buffer.fence);
+        glDeleteBuffers(1, &buffer.buffer);
+    }
+    uploadBuffers.clear();
+    glDeleteTextures(1, &streamTextures.occupancy);
+    glDeleteTextures(1, &streamTextures.fade);
+    glDeleteTextures(1, &streamTextures.noise);
+}
+
+void streamNoise(const noise::Fbm &fbm, int sampleResolution,
+                 NoiseStorage storage) {
+    // Abandon any generation under way. Its thread stops after the slab it
+    // is on.
+    generationThread = std::jthread();
+
+    int n = sampleResolution;
+    int m = occupancyResolution(n);
+    generation = std::make_unique<NoiseGeneration>();
+    generation->fbm = fbm;
+    generation->resolution = n;
+    generation->storage = storage;
+    generation->samples.resize(noiseLevels(n));
+    generation->samples[0].resize(n * n * n);
+    generation->fade.resize(noiseLevels(n));
+
+    glBindTexture(GL_TEXTURE_3D, streamTextures.noise);
+    for (int level = 0; level < noiseLevels(n); level++) {
+        int size = noiseLevelResolution(n, level);
+        glTexImage3D(GL_TEXTURE_3D, level, noiseFormat(storage),
+                     size, size, size, 0, GL_RGBA, GL_FLOAT, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_3D, streamTextures.fade);
+    for (int level = 0; level < noiseLevels(n); level++) {
+        int size = noiseLevelResolution(n, level);
+        glTexImage3D(GL_TEXTURE_3D, level, fadeFormat(storage),
+                     size, size, size, 0, GL_RED, GL_FLOAT, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_3D, streamTextures.occupancy);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RG32F, m, m, m, 0,
+                 GL_RG, GL_FLOAT, nullptr);
+    glBindTexture(GL_TEXTURE_3D, 0);
+    streamTextures.resolution = n;
+
+    generationThread = std::jthread([gen = generation.get()](std::stop_token stop) {
+        generateSlabs(stop, *gen);
+    });
+}
+
+// Copies slab into the next pixel buffer and uploads it from there. Returns
+// false, uploading nothing, if the buffer is still being read or cannot be
+// mapped, so that the slab is tried again on a later frame.
+bool uploadSlab(const NoiseSlab &slab) {
+    UploadBuffer &buffer = uploadBuffers[nextUploadBuffer];
+    if (buffer.fence) {
+        if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            return false;
+        glDeleteSync(buffer.fence);
+        buffer.fence = nullptr;
+    }
+
+    int size = noiseLevelResolution(generation->resolution, slab.level);
+    GLuint tex = streamTextures.noise;
+    GLenum format = GL_RGBA;
+    const void *data = generation->samples[slab.level].data();
+    size_t texelSize = sizeof(glm::vec4);
+    if (slab.texture == NoiseSlab::Fade) {
+        tex = streamTextures.fade;
+        format = GL_RED;
+        data = generation->fade[slab.level].data();
+        texelSize = sizeof(float);
+    } else if (slab.texture == NoiseSlab::Occupancy) {
+        size = occupancyResolution(generation->resolution);
+        tex = streamTextures.occupancy;
+        format = GL_RG;
+        data = generation->occupancy.data();
+        texelSize = sizeof(glm::vec2);
+    }
+    size_t layerSize = size_t(size) * size * texelSize;
+    size_t bytes = layerSize * (slab.zEnd - slab.zBegin);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+    // Orphan the buffer's old storage rather than wait for it
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    void *mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!mapped) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    std::memcpy(mapped, static_cast<const char *>(data) + layerSize * slab.zBegin,
+                bytes);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    glBindTexture(GL_TEXTURE_3D, tex);
+    glTexSubImage3D(GL_TEXTURE_3D, slab.level,
+                    0, 0, slab.zBegin, // offset
+                    size, size, slab.zEnd - slab.zBegin,
+                    format, GL_FLOAT,
+                    nullptr); // offset into the pixel buffer
+    glBindTexture(GL_TEXTURE_3D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextUploadBuffer = (nextUploadBuffer + 1) % uploadBuffers.size();
+    return true;
+}
+
+bool updateNoiseStream(float budgetMs, NoiseTextures &textures) {
+    if (!generation)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    for (bool first = true;; first = false) {
+        NoiseSlab slab;
+        {
+            std::lock_guard<std::mutex> lock(generation->mutex);
+            if (generation->slabs.empty()) {
+                if (!generation->generated)
+                    return false;
+                break;
+            }
+            slab = generation->slabs.front();
+        }
+
+        std::chrono::duration<float, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+        if (!first && elapsed.count() >= budgetMs)
+            return false;
+        if (!uploadSlab(slab))
+            return false;
+
+        // Only this thread takes slabs, so the front is still slab
+        std::lock_guard<std::mutex> lock(generation->mutex);
+        generation->slabs.pop_front();
+    }
+
+    streamTextures.gradEncoding = generation->gradEncoding;
+
+    // The thread has finished, so this only joins it
+    generationThread = std::jthread();
+    generation.reset();
+
+    std::swap(streamTextures, textures);
+    return true;
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "noise.h"
+
+namespace cloud {
+// Regenerates the noise textures without stalling a frame. A worker thread
+// generates the noise a slab of z layers at a time, and each frame uploads
+// the finished slabs, for up to a time budget, into a second set of
+// textures through a ring of pixel buffers. The textures in use stay in use
+// until the new ones are complete.
+
+// A set of textures filled as by generateNoise
+struct NoiseTextures {
+    GLuint noise = 0;
+    GLuint fade = 0;
+    GLuint occupancy = 0;
+    GradientEncoding gradEncoding;
+    int resolution = 0;
+};
+
+void initializeNoiseStream();
+void finalizeNoiseStream();
+
+// Starts generating fbm at sampleResolution^3 samples, in storage's format,
+// abandoning any generation under way
+void streamNoise(const noise::Fbm &fbm, int sampleResolution,
+                 NoiseStorage storage);
+
+// Uploads slabs that have been generated, until budgetMs milliseconds have
+// passed (always at least one slab). Once all of them are uploaded, swaps
+// the new textures with textures, whose old ones are reused by the next
+// generation, and returns true.
+bool updateNoiseStream(float budgetMs, NoiseTextures &textures);
+}
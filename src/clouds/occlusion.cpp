@@ -0,0 +1,91 @@
+#include "occlusion.h"
+
+#include <utils/shaderloader.h>
+
+namespace cloud {
+
+GLuint tileProgram;
+
+GLuint tileFBO;
+GLuint tileDepthTex;
+glm::ivec2 tileCount(0);
+
+GLuint tileVAO;
+
+void initializeOcclusion() {
+    tileProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_downsample.frag");
+
+    glGenTextures(1, &tileDepthTex);
+    glBindTexture(GL_TEXTURE_2D, tileDepthTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &tileFBO);
+    glGenVertexArrays(1, &tileVAO);
+    tileCount = glm::ivec2(0);
+}
+
+void finalizeOcclusion() {
+    glDeleteVertexArrays(1, &tileVAO);
+    glDeleteFramebuffers(1, &tileFBO);
+    glDeleteTextures(1, &tileDepthTex);
+    glDeleteProgram(tileProgram);
+}
+
+glm::ivec2 buildTileDepth(GLuint sceneDepth, glm::ivec2 size, int tileSize) {
+    GLint prevFBO;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFBO);
+    glm::ivec4 prevViewport;
+    glGetIntegerv(GL_VIEWPORT, &prevViewport[0]);
+
+    glm::ivec2 tiles = (size + tileSize - 1) / tileSize;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, tileFBO);
+    if (tiles != tileCount) {
+        glBindTexture(GL_TEXTURE_2D, tileDepthTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, tiles.x, tiles.y, 0,
+                     GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                               GL_TEXTURE_2D, tileDepthTex, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        tileCount = tiles;
+    }
+    glViewport(0, 0, tiles.x, tiles.y);
+
+    // Write every tile's depth
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    glDepthFunc(GL_ALWAYS);
+
+    glUseProgram(tileProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sceneDepth);
+    glUniform1i(glGetUniformLocation(tileProgram, "sceneDepth"), 0);
+    glUniform2iv(glGetUniformLocation(tileProgram, "lowResSize"),
+                 1, &tiles[0]);
+    glBindVertexArray(tileVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    glDepthFunc(depthFunc);
+    glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+
+    return tiles;
+}
+
+GLuint tileDepth() {
+    return tileDepthTex;
+}
+
+}
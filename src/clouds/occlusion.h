@@ -0,0 +1,21 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace cloud {
+// Conservative occlusion of cloud slices by the scene: the farthest depth in
+// each tile of the target, so that cloud.vert can drop the tiles of a slice
+// that lie behind everything in them.
+
+void initializeOcclusion();
+void finalizeOcclusion();
+
+// Fills the tile depth from sceneDepth, a depth texture the size of the
+// target, with tiles tileSize pixels wide. Returns the number of tiles.
+// Keeps the bound framebuffer and viewport.
+glm::ivec2 buildTileDepth(GLuint sceneDepth, glm::ivec2 size, int tileSize);
+
+// Depth texture with one texel per tile
+GLuint tileDepth();
+}
@@ -8,13 +8,177 @@ namespace cloud {
 // Volumetric slicing
 
 float sliceDistance = 0.2;
+// Beyond depth sliceDistance / sliceGrowth, slices are sliceGrowth times
+// their depth apart. 0 spaces all of them sliceDistance apart.
+float sliceGrowth = 0.015;
+// Slices are culled against the scene in tiles of this many pixels a side.
+// 0 culls whole slices only. Small tiles cost more triangles to set up.
+int occlusionTileSize = 32;
+// Drawn front to back, slices go in batches of this many. After each batch,
+// pixels whose alpha has reached saturationAlpha are stenciled out, and
+// later slices are rejected there before shading.
+int saturationInterval = 8;
+float saturationAlpha = 0.99;
+
+// Temporal accumulation
+
+// With accumulation on, slices are this many times further apart. Each frame
+// shifts them by a different fraction of the spacing, so the history fills
+// in the depths between them.
+float temporalSliceSpacing = 4;
+// Frames before the shifts repeat
+unsigned temporalJitterPeriod = 16;
+// Weight of the current frame against the history
+float temporalBlend = 0.1;
+// The history is clipped to the current frame's neighbourhood mean, plus or
+// minus this many standard deviations
+float temporalClampGamma = 1.25;
+
+// Half-angle slicing
+
+// Spacing of the slices along their normal. Every slice is drawn twice, for
+// the camera and for the light buffer, and none are spaced out with depth.
+float halfAngleSliceDistance = 0.4;
+// Texels per side of the light buffer, which covers the whole cloud layer
+int lightBufferResolution = 128;
+
+// Lighting
+
+// Brightness of cloud that no light reaches, relative to cloudColor
+float cloudAmbient = 0.35;
+// Voxels of the precomputed light volume, which covers the whole cloud
+// layer (x, height, z). Shadows are soft, so it can be coarse.
+glm::ivec3 lightVolumeResolution = glm::ivec3(96, 24, 96);
+// z layers of the volume rebuilt per frame, after the light or the clouds
+// change
+int lightVolumeLayersPerFrame = 8;
+
+// Animation
+
+// The noise drifts this fast, in world units per second
+glm::vec3 windVelocity = glm::vec3(0.8, 0, 0.3);
+// Samples are displaced by up to warpAmount of the noise texture, by sine
+// waves with warpFrequency periods per texture, whose phases advance by
+// warpSpeed radians per second
+float warpAmount = 0.02;
+int warpFrequency = 2;
+glm::vec3 warpSpeed = glm::vec3(0.13, 0.07, 0.11);
+// Seconds for the noise to fade into its shifted copy and back
+float evolvePeriod = 90;
+
+// Ray marching
+
+// Step length while searching for cloud, and inside it. Search steps should
+// stay below the thinnest features (noiseSampleScale.y / 16 vertically)
+// times a few, or rays can step over them.
+float marchEmptyStep = 0.6;
+float marchDenseStep = 0.2;
+// Rays stop once less than this fraction of the background shows through
+float marchMinTransmittance = 0.01;
+int marchMaxSteps = 512;
 
 // Perlin noise
 
-std::vector<unsigned int> cloudNoiseResolutions = {
-    2, 4, 8, 16
+// The clouds' shape: octaves at 2 and 4 cells per texture, each weighted by
+// 0.8 / cells
+noise::Fbm shapeNoise = {
+    .octaves = 2,
+    .frequency = 2,
+    .amplitude = 0.4,
+    .lacunarity = 2,
+    .gain = 0.5,
+    .periodic = true,
+};
+// Samples per side of the shape textures. Changing it with
+// setNoiseResolution regenerates them in the background.
+int noiseSampleResolution = 64;
+// Detail: the octaves at 8 and 16 cells per shape texture, weighted as
+// before, in a small texture that repeats detailRepeat times across the
+// shape texture along each axis. Its octaves are hashed as the shape's next
+// ones would be.
+noise::Fbm detailNoise = {
+    .octaves = 2,
+    .frequency = 2, // cells per detail texture
+    .amplitude = 0.1,
+    .lacunarity = 2,
+    .gain = 0.5,
+    .periodic = true,
+    .firstOctave = 2,
+};
+int detailSampleResolution = 32;
+int detailRepeat = 4;
+// The detail is added in full where the shape's density is at least
+// detailFade, and faded out towards its edges, so that it only shapes cloud
+// that is already there
+float detailFade = 0.02;
+// Empty-space skipping: noise samples per side of an occupancy brick, and
+// samples each brick's range extends past it. Filtering mip 0 alone reaches
+// 1 sample away, and blending it with mip 1 reaches 3, so a margin of 1
+// serves fragments that sample mip 0 only. The noise has fine detail
+// everywhere, so larger bricks are rarely empty.
+int occupancyBrickSize = 4;
+int occupancyMargin = 1;
+// Regenerated noise is uploaded for up to this many milliseconds per frame,
+// through a ring of this many pixel buffers
+float noiseUploadBudget = 2;
+int noiseUploadBuffers = 3;
+// Half keeps the gradients precise enough for shading; Unorm has 8 bits
+// for them. The detail is signed, so is not stored as Unorm.
+NoiseStorage noiseStorage = NoiseStorage::Half;
+NoiseStorage detailStorage = NoiseStorage::Half;
+// Generate the noise on the GPU, all at once, rather than on a worker thread
+// and streamed in. Works on Mesa's llvmpipe, but slower there than the CPU.
+bool gpuNoise = false;
+
+// Sparse volume
+
+// Replace the tiling shape noise, near the camera, with the same noise
+// without its period, in bricks generated as the camera moves. Read when
+// the clouds are initialized.
+bool sparseNoise = false;
+// Samples per side of a brick, at noiseSampleResolution samples per noise
+// texture, and even so that the bricks' mip level lines up with their
+// slots. A brick of 16 is 5 x 1 x 5 world units.
+int sparseBrickSize = 16;
+// Bricks around the camera (x, height, z) that can be resident. The window
+// starts a brick below startHeight, so 16 bricks high covers the layer.
+glm::ivec3 sparseWindow = glm::ivec3(32, 16, 32);
+// Megabytes of bricks (with their filtering margins) kept at once
+float sparseMemoryBudget = 128;
+int sparseWorkers = 2;
+// Seconds a brick takes to blend in from the tiling noise, once it and its
+// neighbours are all there
+float sparseFadeTime = 0.5;
+
+// Coverage map
+
+// Shape the cloud cover with a map over the xz plane that drifts with the
+// wind: its coverage thins the clouds out, to none at 0, and its cloud type
+// squashes the height profile towards cloudFloorStart, from flatCloudHeight
+// of its height at type 0 to all of it at 1
+bool coverageMap = false;
+// World units across the map, centered on the y axis like the layer, which
+// the curve keeps within about 75 units of it, and texels per side
+float coverageMapSize = 160;
+int coverageResolution = 256;
+// Sampled in world units. The cloud type is the same fbm from the octave
+// after coverageNoise's last.
+noise::Fbm coverageNoise = {
+    .octaves = 3,
+    .frequency = 0.025,
+    .amplitude = 1,
+    .lacunarity = 2,
+    .gain = 0.5,
 };
-int noiseSampleResolution = 32;
+// Coverage is coverageAmount + coverageContrast * fbm, and the type likewise,
+// each clamped to [0, 1]
+float coverageAmount = 0.7;
+float coverageContrast = 2.5;
+float cloudTypeAmount = 0.6;
+float cloudTypeContrast = 2;
+float flatCloudHeight = 0.4;
+
+glm::vec3 cloudColor = glm::vec3(0.8);
 
 // Used by the shader when sampling
 glm::vec3 noiseSampleScale = glm::vec3(20, 4, 20);
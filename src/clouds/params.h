@@ -3,14 +3,94 @@
 #include <vector>
 #include <glm/glm.hpp>
 
+#include "noise/perlin.h"
+
 namespace cloud {
 
 extern float sliceDistance;
+extern float sliceGrowth;
+extern int occlusionTileSize;
+extern int saturationInterval;
+extern float saturationAlpha;
+
+// Temporal accumulation
+
+extern float temporalSliceSpacing;
+extern unsigned temporalJitterPeriod;
+extern float temporalBlend;
+extern float temporalClampGamma;
+
+// Half-angle slicing
+
+extern float halfAngleSliceDistance;
+extern int lightBufferResolution;
+
+// Lighting
+
+extern float cloudAmbient;
+extern glm::ivec3 lightVolumeResolution;
+extern int lightVolumeLayersPerFrame;
+
+// Animation
+
+extern glm::vec3 windVelocity;
+extern float warpAmount;
+extern int warpFrequency;
+extern glm::vec3 warpSpeed;
+extern float evolvePeriod;
+
+// Ray marching
+
+extern float marchEmptyStep;
+extern float marchDenseStep;
+extern float marchMinTransmittance;
+extern int marchMaxSteps;
 
 // Perlin noise
 
-extern std::vector<unsigned int> cloudNoiseResolutions;
+extern noise::Fbm shapeNoise;
 extern int noiseSampleResolution;
+extern noise::Fbm detailNoise;
+extern int detailSampleResolution;
+extern int detailRepeat;
+extern float detailFade;
+extern int occupancyBrickSize;
+extern int occupancyMargin;
+extern float noiseUploadBudget;
+extern int noiseUploadBuffers;
+
+// GPU format of the noise textures (gradient and density)
+enum class NoiseStorage {
+    Unorm, // RGBA8. Negative densities clamp to 0, as the shader does.
+    Half,  // RGBA16F
+    Float, // RGBA32F
+};
+extern NoiseStorage noiseStorage;
+extern NoiseStorage detailStorage;
+extern bool gpuNoise;
+
+// Sparse volume
+
+extern bool sparseNoise;
+extern int sparseBrickSize;
+extern glm::ivec3 sparseWindow;
+extern float sparseMemoryBudget;
+extern int sparseWorkers;
+extern float sparseFadeTime;
+
+// Coverage map
+
+extern bool coverageMap;
+extern float coverageMapSize;
+extern int coverageResolution;
+extern noise::Fbm coverageNoise;
+extern float coverageAmount;
+extern float coverageContrast;
+extern float cloudTypeAmount;
+extern float cloudTypeContrast;
+extern float flatCloudHeight;
+
+extern glm::vec3 cloudColor;
 
 extern float startHeight;
 extern int heightTexHeight;
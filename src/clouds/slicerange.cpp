@@ -0,0 +1,168 @@
+#include "slicerange.h"
+
+#include <algorithm>
+
+#include "params.h"
+
+namespace cloud {
+
+namespace {
+
+// Same curve as cloud_density.glsl: h = y - startHeight + (|xz| / curveRadius)^2
+constexpr float curveRadius = 20;
+
+// The height over a slice, in the slice's coordinates (s, t) in [-1, 1]^2:
+// a s^2 + b t^2 + c s t + d s + e t + f. The curve makes it convex.
+struct SliceHeight {
+    float a, b, c, d, e, f;
+
+    float operator()(float s, float t) const {
+        return a * s * s + b * t * t + c * s * t + d * s + e * t + f;
+    }
+
+    // Minimum over t in [-1, 1] with s fixed. The t^2 coefficient is
+    // never negative.
+    float minOverT(float s) const {
+        float linear = c * s + e;
+        float t = b > 0 ? glm::clamp(-linear / (2 * b), -1.f, 1.f)
+                        : (linear > 0 ? -1.f : 1.f);
+        return (*this)(s, t);
+    }
+
+    float minOverS(float t) const {
+        float linear = c * t + d;
+        float s = a > 0 ? glm::clamp(-linear / (2 * a), -1.f, 1.f)
+                        : (linear > 0 ? -1.f : 1.f);
+        return (*this)(s, t);
+    }
+};
+
+// Whether the rectangle center + [-1, 1] * right + [-1, 1] * up has points
+// with heights in range
+bool crossesLayer(glm::vec3 center, glm::vec3 right, glm::vec3 up,
+                  glm::vec2 range) {
+    float k = 1 / (curveRadius * curveRadius);
+    glm::vec2 c(center.x, center.z);
+    glm::vec2 r(right.x, right.z);
+    glm::vec2 u(up.x, up.z);
+    SliceHeight h = {
+        glm::dot(r, r) * k,
+        glm::dot(u, u) * k,
+        2 * glm::dot(r, u) * k,
+        right.y + 2 * glm::dot(c, r) * k,
+        up.y + 2 * glm::dot(c, u) * k,
+        center.y - startHeight + glm::dot(c, c) * k,
+    };
+
+    // A convex function is largest at a corner of the rectangle
+    float maxHeight = std::max({h(-1, -1), h(1, -1), h(-1, 1), h(1, 1)});
+    if (maxHeight < range.x)
+        return false;
+
+    // ...and smallest at its unconstrained minimum, if that is inside,
+    // or else on an edge
+    float minHeight = std::min({h.minOverT(-1), h.minOverT(1),
+                                h.minOverS(-1), h.minOverS(1)});
+    float det = 4 * h.a * h.b - h.c * h.c;
+    if (det > 0) {
+        float s = (h.c * h.e - 2 * h.b * h.d) / det;
+        float t = (h.c * h.d - 2 * h.a * h.e) / det;
+        if (glm::abs(s) <= 1 && glm::abs(t) <= 1)
+            minHeight = std::min(minHeight, h(s, t));
+    }
+    return minHeight <= range.y;
+}
+
+}
+
+float SliceLayout::depth(float k) const {
+    if (growth <= 0 || k * growth <= 1)
+        return k * spacing;
+    return spacing / growth * glm::pow(1 + growth, k - 1 / growth);
+}
+
+int SliceLayout::count(float far) const {
+    int k = 0;
+    while (depth(k) < far)
+        k++;
+    return k - 1;
+}
+
+glm::ivec2 visibleSlices(const Camera &camera, const SliceLayout &layout,
+                         int numSlices, glm::vec2 heightRange) {
+    glm::ivec2 range(numSlices, -1);
+    if (heightRange.x > heightRange.y)
+        return range;
+
+    // Camera basis, as in Camera::getViewMatrix
+    glm::vec3 forward = glm::normalize(camera.look);
+    glm::vec3 up = glm::normalize(camera.up - glm::dot(camera.up, forward) * forward);
+    glm::vec3 right = glm::cross(forward, up);
+    float tanX = glm::tan(camera.widthAngle / 2);
+    float tanY = glm::tan(camera.heightAngle / 2);
+
+    for (int k = 0; k < numSlices; k++) {
+        float depth = layout.depth(k);
+        if (crossesLayer(camera.pos + depth * forward,
+                         depth * tanX * right, depth * tanY * up,
+                         heightRange)) {
+            range.x = std::min(range.x, k);
+            range.y = k;
+        }
+    }
+    return range;
+}
+
+glm::vec4 cloudBounds(glm::vec2 heightRange) {
+    // Above startHeight, where the curve can only lower the layer, and at
+    // most as far from the y axis as the curve reaches heightRange.y
+    float top = glm::max(heightRange.y, 0.f);
+    float radius = curveRadius * glm::sqrt(top);
+    return glm::vec4(0, startHeight + top / 2, 0,
+                     glm::sqrt(radius * radius + top * top / 4));
+}
+
+HalfAngleLayout halfAngleSlices(const Camera &camera, float far,
+                                glm::vec3 lightDir, float spacing,
+                                glm::vec2 heightRange) {
+    glm::vec3 forward = glm::normalize(camera.look);
+    glm::vec3 light = glm::normalize(lightDir);
+    HalfAngleLayout layout;
+    layout.frontToBack = glm::dot(forward, light) >= 0;
+    layout.axis = glm::normalize(layout.frontToBack ? light + forward
+                                                    : light - forward);
+    layout.spacing = spacing;
+    layout.first = 0;
+    layout.count = 0;
+    if (heightRange.x > heightRange.y)
+        return layout;
+
+    // Extent along the axis of the view up to far...
+    glm::vec3 up = glm::normalize(camera.up - glm::dot(camera.up, forward) * forward);
+    glm::vec3 right = glm::cross(forward, up);
+    float tanX = glm::tan(camera.widthAngle / 2);
+    float tanY = glm::tan(camera.heightAngle / 2);
+    float viewMin = glm::dot(layout.axis, camera.pos);
+    float viewMax = viewMin;
+    for (float x : {-1.f, 1.f}) {
+        for (float y : {-1.f, 1.f}) {
+            glm::vec3 corner = camera.pos
+                    + far * (forward + x * tanX * right + y * tanY * up);
+            viewMin = std::min(viewMin, glm::dot(layout.axis, corner));
+            viewMax = std::max(viewMax, glm::dot(layout.axis, corner));
+        }
+    }
+
+    // ...and of the cloud layer
+    glm::vec4 bounds = cloudBounds(heightRange);
+    float center = glm::dot(layout.axis, glm::vec3(bounds));
+    float low = std::max(viewMin, center - bounds.w);
+    float high = std::min(viewMax, center + bounds.w);
+    if (low < high) {
+        layout.first = low;
+        layout.count = (int)glm::ceil((high - low) / spacing);
+    }
+    return layout;
+}
+
+}
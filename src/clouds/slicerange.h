@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <camera.h>
+
+namespace cloud {
+// View depths of the slices, as cloud.vert computes them. Near slices are
+// spacing apart. Beyond depth spacing / growth, where that is less than
+// growth times the depth, each slice is growth times its depth further than
+// the one before, so slices cover about the same number of pixels of depth.
+struct SliceLayout {
+    float spacing;
+    float growth;
+
+    // Depth of slice k
+    float depth(float k) const;
+    // Number of slices in front of far
+    int count(float far) const;
+};
+
+// Of the slices k in [0, numSlices), returns the first and last k whose
+// slice can cross the cloud layer: the points where the curved height (as
+// in cloud_density.glsl) is within heightRange. The range is empty (x > y)
+// if no slice crosses it.
+glm::ivec2 visibleSlices(const Camera &camera, const SliceLayout &layout,
+                         int numSlices, glm::vec2 heightRange);
+
+// Bounding sphere (xyz center, w radius) of the points where the curved
+// height is within heightRange
+glm::vec4 cloudBounds(glm::vec2 heightRange);
+
+// Half-angle slices (GPU Gems, chapter 39): planes dot(axis, x) = first +
+// k * spacing, for k in [0, count), whose normal is halfway between the
+// light's direction and the view's (or its reverse). Drawn in order of k,
+// they are in order both for the camera and for the light.
+struct HalfAngleLayout {
+    glm::vec3 axis;
+    float first;
+    float spacing;
+    int count;
+    // Whether the camera sees the slices front to back
+    bool frontToBack;
+};
+
+// Slices spacing apart through the camera's view up to far, where it can
+// meet the cloud layer's heightRange. lightDir is the direction the light
+// travels. The count is 0 if there is nothing to draw.
+HalfAngleLayout halfAngleSlices(const Camera &camera, float far,
+                                glm::vec3 lightDir, float spacing,
+                                glm::vec2 heightRange);
+}
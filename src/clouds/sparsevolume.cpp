@@ -0,0 +1,601 @@
+#include "sparsevolume.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "noise.h"
+#include "params.h"
+
+namespace cloud {
+
+namespace {
+
+// Same curve as cloud_density.glsl: h = y - startHeight + (|xz| / curveRadius)^2
+constexpr float curveRadius = 20;
+
+// Floored modulo, for table indices of negative bricks
+glm::ivec3 wrap(glm::ivec3 a, glm::ivec3 b) {
+    return (a % b + b) % b;
+}
+
+}
+
+// Bricks are stored with a sample of margin on every side, so that
+// filtering never reads a neighbouring slot
+int paddedBrickSize() {
+    return sparseBrickSize + 2;
+}
+
+struct BrickJob {
+    glm::ivec3 brick;
+    int generation;
+    noise::Fbm fbm;
+    int resolution;
+};
+
+struct BrickResult {
+    glm::ivec3 brick;
+    int generation;
+    bool empty;
+    std::vector<glm::vec4> samples;
+};
+
+// Work passed between the main thread and the workers
+struct BrickQueue {
+    std::mutex mutex;
+    std::condition_variable_any jobReady;
+    std::deque<BrickJob> jobs;
+    std::deque<BrickResult> results;
+};
+BrickQueue brickQueue;
+
+// A brick of the window, as the main thread tracks it
+struct BrickEntry {
+    enum State { Absent, Queued, Empty, Resident };
+
+    glm::ivec3 brick;
+    State state = Absent;
+    // Empty because of its height, which can change as it drifts
+    bool culled = false;
+    int slot = -1;
+    // How much of the shape near the brick's center comes from the sparse
+    // volume. It rises to 1 over sparseFadeTime once the brick and its
+    // neighbours are all there, and drops to 0 as soon as one is not.
+    float weight = 0;
+};
+
+GLuint brickTableTex;
+GLuint brickAtlasTex;
+GLuint brickWeightsTex;
+glm::ivec3 atlasSlots;
+std::vector<int> freeSlots;
+
+std::vector<BrickEntry> brickEntries;
+bool windowValid = false;
+glm::ivec3 windowMin;
+bool tableDirty = false;
+// The weights as last uploaded, in table order
+std::vector<std::uint8_t> uploadedWeights;
+std::chrono::steady_clock::time_point lastUpdate;
+
+// Bumped by resetSparseVolume, so that bricks of older noise are dropped
+int sparseGeneration = 0;
+int sparseResolution = 0;
+// Jobs queued or being generated, whose results have not been collected
+int bricksInFlight = 0;
+
+// Declared after brickQueue, so they are joined before it is destroyed
+std::vector<std::jthread> brickWorkers;
+
+// Samples fbm over the brick and its margin. Sample i of the noise, as in
+// the tiling texture, is at (i + 0.5) / resolution.
+BrickResult generateBrick(const BrickJob &job) {
+    int p = paddedBrickSize();
+    size_t count = size_t(p) * p * p;
+    std::vector<float> x(count), y(count), z(count), value(count);
+    std::vector<float> dx(count), dy(count), dz(count);
+    glm::ivec3 origin = job.brick * sparseBrickSize - 1;
+    size_t i = 0;
+    for (int k = 0; k < p; k++) {
+    for (int j = 0; j < p; j++) {
+    for (int l = 0; l < p; l++, i++) {
+        x[i] = (origin.x + l + 0.5f) / job.resolution;
+        y[i] = (origin.y + j + 0.5f) / job.resolution;
+        z[i] = (origin.z + k + 0.5f) / job.resolution;
+    }
+    }
+    }
+    noise::fbm3Grad(noiseGradients(), job.fbm, x.data(), y.data(), z.data(),
+                    value.data(), dx.data(), dy.data(), dz.data(), count);
+
+    BrickResult result;
+    result.brick = job.brick;
+    result.generation = job.generation;
+    // Filtering anywhere in the brick only reads its samples, so if none
+    // is positive, neither is any lookup
+    result.empty = *std::max_element(value.begin(), value.end()) <= 0;
+    if (result.empty)
+        return result;
+
+    // Level 0, then level 1, whose texels each average 2^3 of level 0's. The
+    // margin is a sample, so level 1 lines up with its slot as well.
+    int q = p / 2;
+    result.samples.resize(count + size_t(q) * q * q, glm::vec4(0));
+    for (i = 0; i < count; i++) {
+        result.samples[i] = glm::vec4(dx[i], dy[i], dz[i], value[i]);
+    }
+    glm::vec4 *level1 = &result.samples[count];
+    i = 0;
+    for (int k = 0; k < p; k++) {
+    for (int j = 0; j < p; j++) {
+    for (int l = 0; l < p; l++, i++) {
+        level1[((k / 2) * q + j / 2) * q + l / 2] += result.samples[i] / 8.f;
+    }
+    }
+    }
+    return result;
+}
+
+void generateBricks(std::stop_token stop) {
+    while (true) {
+        BrickJob job;
+        {
+            std::unique_lock<std::mutex> lock(brickQueue.mutex);
+            if (!brickQueue.jobReady.wait(lock, stop, [] {
+                    return !brickQueue.jobs.empty();
+                }))
+                return;
+            job = brickQueue.jobs.front();
+            brickQueue.jobs.pop_front();
+        }
+        BrickResult result = generateBrick(job);
+        std::lock_guard<std::mutex> lock(brickQueue.mutex);
+        brickQueue.results.push_back(std::move(result));
+    }
+}
+
+int tableIndex(glm::ivec3 brick) {
+    glm::ivec3 t = wrap(brick, sparseWindow);
+    return (t.z * sparseWindow.y + t.y) * sparseWindow.x + t.x;
+}
+
+glm::ivec3 slotOrigin(int slot) {
+    glm::ivec3 s(slot % atlasSlots.x, slot / atlasSlots.x % atlasSlots.y,
+                 slot / (atlasSlots.x * atlasSlots.y));
+    return s * paddedBrickSize();
+}
+
+void initializeSparseVolume() {
+    glm::ivec3 w = sparseWindow;
+    glGenTextures(1, &brickTableTex);
+    glBindTexture(GL_TEXTURE_3D, brickTableTex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    std::vector<glm::u8vec4> table(size_t(w.x) * w.y * w.z, glm::u8vec4(0));
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA8UI, w.x, w.y, w.z, 0,
+                 GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, table.data());
+
+    // Filtered between brick centers, wrapping as the table does
+    uploadedWeights.assign(table.size(), 0);
+    glGenTextures(1, &brickWeightsTex);
+    glBindTexture(GL_TEXTURE_3D, brickWeightsTex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexImage3D(GL_TEXTURE_3D, 0, GL_R8, w.x, w.y, w.z, 0,
+                 GL_RED, GL_UNSIGNED_BYTE, uploadedWeights.data());
+
+    // Slots of the atlas, a cube of them within the budget. Without the
+    // sparse volume, a single slot keeps the sampler valid.
+    int p = paddedBrickSize();
+    int side = 1;
+    if (sparseNoise) {
+        // RGBA16F, as the tiling noise is by default, and a mip level
+        double slotBytes = double(p) * p * p * 8 * 9 / 8;
+        side = int(std::cbrt(sparseMemoryBudget * 1024 * 1024 / slotBytes));
+        GLint maxSize;
+        glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+        // Slot coordinates are stored in 8 bits
+        side = glm::clamp(side, 1, glm::min(255, maxSize / p));
+    }
+    atlasSlots = glm::ivec3(side);
+    glGenTextures(1, &brickAtlasTex);
+    glBindTexture(GL_TEXTURE_3D, brickAtlasTex);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    // Coarser levels would mix neighbouring slots
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAX_LEVEL, 1);
+    for (int level = 0; level <= 1; level++) {
+        int size = side * p >> level;
+        glTexImage3D(GL_TEXTURE_3D, level, GL_RGBA16F, size, size, size, 0,
+                     GL_RGBA, GL_FLOAT, nullptr);
+    }
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    brickEntries.assign(table.size(), BrickEntry());
+    resetSparseVolume();
+
+    if (sparseNoise) {
+        for (int i = 0; i < glm::max(sparseWorkers, 1); i++) {
+            brickWorkers.emplace_back(generateBricks);
+        }
+    }
+}
+
+void finalizeSparseVolume() {
+    brickWorkers.clear();
+    brickQueue.jobs.clear();
+    brickQueue.results.clear();
+    bricksInFlight = 0;
+    glDeleteTextures(1, &brickWeightsTex);
+    glDeleteTextures(1, &brickAtlasTex);
+    glDeleteTextures(1, &brickTableTex);
+}
+
+void resetSparseVolume() {
+    sparseGeneration++;
+    sparseResolution = noiseSampleResolution;
+    {
+        // Results of jobs under way are dropped as they come in
+        std::lock_guard<std::mutex> lock(brickQueue.mutex);
+        bricksInFlight -= int(brickQueue.jobs.size());
+        brickQueue.jobs.clear();
+    }
+    for (BrickEntry &entry : brickEntries) {
+        entry = BrickEntry();
+    }
+    freeSlots.clear();
+    for (int slot = atlasSlots.x * atlasSlots.y * atlasSlots.z - 1; slot >= 0; slot--) {
+        freeSlots.push_back(slot);
+    }
+    windowValid = false;
+    tableDirty = true;
+}
+
+// The update's view of the clouds: sample coordinates of world positions
+struct SparseFrame {
+    glm::dvec3 drift;
+    glm::vec3 cameraPos;
+
+    glm::dvec3 toSamples(glm::dvec3 p) const {
+        return (p / glm::dvec3(noiseSampleScale) + drift) * double(sparseResolution);
+    }
+    glm::dvec3 toWorld(glm::dvec3 s) const {
+        return (s / double(sparseResolution) - drift) * glm::dvec3(noiseSampleScale);
+    }
+    float distance(glm::ivec3 brick) const {
+        glm::dvec3 center = (glm::dvec3(brick) + 0.5) * double(sparseBrickSize);
+        return glm::distance(glm::vec3(toWorld(center)), cameraPos);
+    }
+};
+
+// Whether the brick is entirely outside the heights the clouds reach
+bool heightCulled(const SparseFrame &frame, glm::ivec3 brick,
+                  glm::vec2 heightRange) {
+    if (heightRange.x > heightRange.y)
+        return true;
+    glm::vec3 lo(frame.toWorld(glm::dvec3(brick * sparseBrickSize)));
+    glm::vec3 hi(frame.toWorld(glm::dvec3((brick + 1) * sparseBrickSize)));
+    // Widened by the warp and by the sample filtering reaches
+    glm::vec3 margin = (warpAmount + 2.f / sparseResolution) * noiseSampleScale;
+    lo -= margin;
+    hi += margin;
+
+    // Nearest and furthest squared distances from the y axis
+    glm::vec2 nearest = glm::clamp(glm::vec2(0), glm::vec2(lo.x, lo.z),
+                                   glm::vec2(hi.x, hi.z));
+    glm::vec2 furthest = glm::max(glm::abs(glm::vec2(lo.x, lo.z)),
+                                  glm::abs(glm::vec2(hi.x, hi.z)));
+    float k = 1 / (curveRadius * curveRadius);
+    float bottom = glm::max(startHeight,
+                            startHeight + heightRange.x - glm::dot(furthest, furthest) * k);
+    float top = startHeight + heightRange.y - glm::dot(nearest, nearest) * k;
+    return hi.y <= bottom || lo.y >= top;
+}
+
+// Points the window's entries at the bricks of the window from newMin,
+// dropping the bricks that have left it
+bool moveWindow(glm::ivec3 newMin) {
+    bool changed = false;
+    for (int z = 0; z < sparseWindow.z; z++) {
+    for (int y = 0; y < sparseWindow.y; y++) {
+    for (int x = 0; x < sparseWindow.x; x++) {
+        glm::ivec3 brick = newMin + wrap(glm::ivec3(x, y, z) - newMin, sparseWindow);
+        BrickEntry &entry = brickEntries[tableIndex(brick)];
+        if (windowValid && entry.brick == brick)
+            continue;
+        if (entry.state == BrickEntry::Resident) {
+            freeSlots.push_back(entry.slot);
+            changed = true;
+        }
+        entry = BrickEntry();
+        entry.brick = brick;
+    }
+    }
+    }
+
+    // Queued bricks that have left are not worth generating
+    std::lock_guard<std::mutex> lock(brickQueue.mutex);
+    std::erase_if(brickQueue.jobs, [&](const BrickJob &job) {
+        if (brickEntries[tableIndex(job.brick)].brick == job.brick)
+            return false;
+        bricksInFlight--;
+        return true;
+    });
+
+    windowMin = newMin;
+    windowValid = true;
+    tableDirty = true;
+    return changed;
+}
+
+// A slot for a brick at distance, taken from the furthest resident brick if
+// none is free and that one is further. -1 if there is none to give.
+int takeSlot(const SparseFrame &frame, float distance) {
+    if (!freeSlots.empty()) {
+        int slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    BrickEntry *furthest = nullptr;
+    float furthestDistance = distance;
+    for (BrickEntry &entry : brickEntries) {
+        if (entry.state != BrickEntry::Resident)
+            continue;
+        float d = frame.distance(entry.brick);
+        if (d > furthestDistance) {
+            furthest = &entry;
+            furthestDistance = d;
+        }
+    }
+    if (!furthest)
+        return -1;
+    furthest->state = BrickEntry::Absent;
+    return std::exchange(furthest->slot, -1);
+}
+
+void uploadBrick(int slot, const std::vector<glm::vec4> &samples) {
+    int p = paddedBrickSize();
+    glm::ivec3 origin = slotOrigin(slot);
+    glBindTexture(GL_TEXTURE_3D, brickAtlasTex);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, origin.x, origin.y, origin.z, p, p, p,
+                    GL_RGBA, GL_FLOAT, samples.data());
+    const glm::vec4 *level1 = &samples[size_t(p) * p * p];
+    origin /= 2;
+    p /= 2;
+    glTexSubImage3D(GL_TEXTURE_3D, 1, origin.x, origin.y, origin.z, p, p, p,
+                    GL_RGBA, GL_FLOAT, level1);
+    glBindTexture(GL_TEXTURE_3D, 0);
+}
+
+void uploadTable() {
+    std::vector<glm::u8vec4> table(brickEntries.size(), glm::u8vec4(0));
+    for (size_t i = 0; i < brickEntries.size(); i++) {
+        const BrickEntry &entry = brickEntries[i];
+        if (entry.state == BrickEntry::Empty) {
+            table[i] = glm::u8vec4(0, 0, 0, 1);
+        } else if (entry.state == BrickEntry::Resident) {
+            glm::ivec3 slot = slotOrigin(entry.slot) / paddedBrickSize();
+            table[i] = glm::u8vec4(slot, 2);
+        }
+    }
+    glBindTexture(GL_TEXTURE_3D, brickTableTex);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0,
+                    sparseWindow.x, sparseWindow.y, sparseWindow.z,
+                    GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, table.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    tableDirty = false;
+}
+
+// Moves each brick's weight towards 1 if it and its neighbours are all
+// resident or empty, and within the window, or straight to 0 otherwise.
+// The shaders filter the weights between brick centers, so the shape only
+// comes from bricks that are there, and blends into the tiling noise over a
+// brick towards the window's edge and missing bricks. Returns whether the
+// uploaded weights changed.
+bool updateWeights(float seconds) {
+    // Eroded by one brick along each axis in turn, in window order
+    glm::ivec3 w = sparseWindow;
+    std::vector<std::uint8_t> ready(brickEntries.size());
+    for (int z = 0; z < w.z; z++) {
+    for (int y = 0; y < w.y; y++) {
+    for (int x = 0; x < w.x; x++) {
+        const BrickEntry &entry = brickEntries[tableIndex(windowMin + glm::ivec3(x, y, z))];
+        ready[(z * w.y + y) * w.x + x] = entry.state == BrickEntry::Empty
+                || entry.state == BrickEntry::Resident;
+    }
+    }
+    }
+    std::vector<std::uint8_t> eroded(ready.size());
+    for (int axis = 0; axis < 3; axis++) {
+        int stride = axis == 0 ? 1 : axis == 1 ? w.x : w.x * w.y;
+        for (int z = 0; z < w.z; z++) {
+        for (int y = 0; y < w.y; y++) {
+        for (int x = 0; x < w.x; x++) {
+            int i = (z * w.y + y) * w.x + x;
+            int c = glm::ivec3(x, y, z)[axis];
+            eroded[i] = ready[i] && c > 0 && c < w[axis] - 1
+                    && ready[i - stride] && ready[i + stride];
+        }
+        }
+        }
+        std::swap(ready, eroded);
+    }
+
+    float step = sparseFadeTime > 0 ? seconds / sparseFadeTime : 1;
+    std::vector<std::uint8_t> weights(brickEntries.size());
+    for (int z = 0; z < w.z; z++) {
+    for (int y = 0; y < w.y; y++) {
+    for (int x = 0; x < w.x; x++) {
+        int i = tableIndex(windowMin + glm::ivec3(x, y, z));
+        BrickEntry &entry = brickEntries[i];
+        entry.weight = ready[(z * w.y + y) * w.x + x]
+                ? glm::min(entry.weight + step, 1.f) : 0;
+        weights[i] = std::uint8_t(std::lround(entry.weight * 255));
+    }
+    }
+    }
+    if (weights == uploadedWeights)
+        return false;
+    glBindTexture(GL_TEXTURE_3D, brickWeightsTex);
+    glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, w.x, w.y, w.z,
+                    GL_RED, GL_UNSIGNED_BYTE, weights.data());
+    glBindTexture(GL_TEXTURE_3D, 0);
+    uploadedWeights = std::move(weights);
+    return true;
+}
+
+bool updateSparseVolume(glm::vec3 cameraPos, const NoiseAnimation &animation,
+                        glm::vec2 heightRange, float budgetMs) {
+    if (!sparseNoise)
+        return false;
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<float> sinceLast = start - lastUpdate;
+    float seconds = windowValid ? sinceLast.count() : 0;
+    lastUpdate = start;
+    SparseFrame frame{animation.drift, cameraPos};
+
+    // Centered on the camera across, and from just below the layer up
+    glm::ivec3 newMin(glm::floor(frame.toSamples(cameraPos) / double(sparseBrickSize)));
+    newMin -= sparseWindow / 2;
+    glm::dvec3 bottom = frame.toSamples(glm::dvec3(0, startHeight, 0));
+    newMin.y = int(glm::floor(bottom.y / sparseBrickSize)) - 1;
+    bool changed = false;
+    if (!windowValid || newMin != windowMin)
+        changed |= moveWindow(newMin);
+
+    // The clouds drift past the curve of the layer, so bricks culled by
+    // their height are checked again every update
+    for (BrickEntry &entry : brickEntries) {
+        bool empty = entry.state == BrickEntry::Empty;
+        if (entry.state == BrickEntry::Absent || (empty && entry.culled)) {
+            bool culled = heightCulled(frame, entry.brick, heightRange);
+            if (culled != empty) {
+                entry.state = culled ? BrickEntry::Empty : BrickEntry::Absent;
+                entry.culled = culled;
+                tableDirty = true;
+            }
+        }
+    }
+
+    // Finished bricks
+    for (bool first = true;; first = false) {
+        std::chrono::duration<float, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+        if (!first && elapsed.count() >= budgetMs)
+            break;
+        BrickResult result;
+        {
+            std::lock_guard<std::mutex> lock(brickQueue.mutex);
+            if (brickQueue.results.empty())
+                break;
+            result = std::move(brickQueue.results.front());
+            brickQueue.results.pop_front();
+        }
+        bricksInFlight--;
+
+        BrickEntry &entry = brickEntries[tableIndex(result.brick)];
+        if (result.generation != sparseGeneration || entry.brick != result.brick
+                || entry.state != BrickEntry::Queued)
+            continue;
+        tableDirty = true;
+        if (result.empty) {
+            entry.state = BrickEntry::Empty;
+            continue;
+        }
+        int slot = takeSlot(frame, frame.distance(entry.brick));
+        if (slot < 0) {
+            entry.state = BrickEntry::Absent;
+            continue;
+        }
+        uploadBrick(slot, result.samples);
+        entry.state = BrickEntry::Resident;
+        entry.slot = slot;
+        changed = true;
+    }
+
+    // Queue the nearest missing bricks. Once the atlas is spoken for, only
+    // bricks nearer than the furthest resident one are worth generating.
+    int maxInFlight = 4 * glm::max(sparseWorkers, 1);
+    if (bricksInFlight < maxInFlight) {
+        std::vector<std::pair<float, int>> missing;
+        float furthest = 0;
+        for (size_t i = 0; i < brickEntries.size(); i++) {
+            const BrickEntry &entry = brickEntries[i];
+            if (entry.state == BrickEntry::Absent) {
+                missing.emplace_back(frame.distance(entry.brick), i);
+            } else if (entry.state == BrickEntry::Resident) {
+                furthest = glm::max(furthest, frame.distance(entry.brick));
+            }
+        }
+        size_t count = std::min(missing.size(), size_t(maxInFlight - bricksInFlight));
+        std::partial_sort(missing.begin(), missing.begin() + count, missing.end());
+
+        std::lock_guard<std::mutex> lock(brickQueue.mutex);
+        for (size_t i = 0; i < count; i++) {
+            if (int(freeSlots.size()) <= bricksInFlight && missing[i].first >= furthest)
+                break;
+            BrickEntry &entry = brickEntries[missing[i].second];
+            brickQueue.jobs.push_back({entry.brick, sparseGeneration,
+                                       shapeNoise, sparseResolution});
+            brickQueue.jobs.back().fbm.periodic = false;
+            entry.state = BrickEntry::Queued;
+            bricksInFlight++;
+        }
+        brickQueue.jobReady.notify_all();
+    }
+
+    if (tableDirty) {
+        uploadTable();
+        changed = true;
+    }
+    changed |= updateWeights(seconds);
+    return changed;
+}
+
+void bindSparseVolume(GLuint program, const NoiseAnimation &animation,
+                      int tableUnit, int atlasUnit, int weightsUnit) {
+    // Bound even when unused: samplers of different types must not share a
+    // unit
+    glActiveTexture(GL_TEXTURE0 + tableUnit);
+    glBindTexture(GL_TEXTURE_3D, brickTableTex);
+    glUniform1i(glGetUniformLocation(program, "brickTable"), tableUnit);
+    glActiveTexture(GL_TEXTURE0 + atlasUnit);
+    glBindTexture(GL_TEXTURE_3D, brickAtlasTex);
+    glUniform1i(glGetUniformLocation(program, "brickAtlas"), atlasUnit);
+    glActiveTexture(GL_TEXTURE0 + weightsUnit);
+    glBindTexture(GL_TEXTURE_3D, brickWeightsTex);
+    glUniform1i(glGetUniformLocation(program, "brickWeights"), weightsUnit);
+    glActiveTexture(GL_TEXTURE0);
+
+    bool sparse = sparseNoise && windowValid;
+    glUniform1i(glGetUniformLocation(program, "sparse"), sparse);
+    if (!sparse)
+        return;
+    // The shaders' noise coordinates are offset by the wrapped drift. In
+    // samples from the window's first brick, they are offset by the rest.
+    glm::dvec3 shift = (animation.drift - glm::dvec3(animation.offset)) * double(sparseResolution)
+            - glm::dvec3(windowMin * sparseBrickSize);
+    glUniform3f(glGetUniformLocation(program, "sparseShift"),
+                float(shift.x), float(shift.y), float(shift.z));
+    glUniform1f(glGetUniformLocation(program, "sparseResolution"), sparseResolution);
+    glUniform1f(glGetUniformLocation(program, "brickSize"), sparseBrickSize);
+    glUniform3iv(glGetUniformLocation(program, "brickWindow"), 1, &sparseWindow[0]);
+    glm::ivec3 tableShift = wrap(windowMin, sparseWindow);
+    glUniform3iv(glGetUniformLocation(program, "brickTableShift"), 1, &tableShift[0]);
+    glm::vec3 atlasSize(atlasSlots * paddedBrickSize());
+    glUniform3fv(glGetUniformLocation(program, "atlasSize"), 1, &atlasSize[0]);
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "animation.h"
+
+namespace cloud {
+// A non-repeating version of the clouds' shape, for skies wider than the
+// tiling noise texture. The shape noise, without its period, is split into
+// bricks of sparseBrickSize^3 samples, and a window of sparseWindow bricks
+// follows the camera. Worker threads generate the window's bricks nearest
+// first. Those with cloud in them are uploaded into the slots of an atlas of
+// fixed size, and a table with a texel per brick of the window says where
+// each one is. Bricks empty of noise, or outside the heights the clouds
+// reach, take no slot. Once the atlas is full, the brick furthest from the
+// camera gives up its slot to a nearer one. The shaders blend into the
+// tiling noise over a brick towards the window's edge and bricks that are
+// not there yet, and bricks blend in over sparseFadeTime as they arrive.
+// The bricks' noise does not match the tiling noise, so bricks that leave
+// the window, or give up their slot, still change the shape at once.
+
+void initializeSparseVolume();
+void finalizeSparseVolume();
+
+// Drops every brick, for noise whose parameters have changed
+void resetSparseVolume();
+
+// Moves the window to cameraPos, for the clouds as animation moves them and
+// their heightRange (as in cloud_density.glsl), queues the bricks it is missing,
+// and uploads finished ones for up to budgetMs milliseconds (always at
+// least one). Returns whether the clouds changed. Does nothing unless
+// sparseNoise is set.
+bool updateSparseVolume(glm::vec3 cameraPos, const NoiseAnimation &animation,
+                        glm::vec2 heightRange, float budgetMs);
+
+// Binds the table, the atlas and the bricks' weights to texture units
+// tableUnit, atlasUnit and weightsUnit, and sets the uniforms of the
+// program in use for the clouds as animation moves them. Its "sparse"
+// uniform is false until there is a window.
+void bindSparseVolume(GLuint program, const NoiseAnimation &animation,
+                      int tableUnit, int atlasUnit, int weightsUnit);
+}
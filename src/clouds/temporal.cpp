@@ -0,0 +1,138 @@
+#include "temporal.h"
+
+#include <utils/shaderloader.h>
+
+#include "params.h"
+
+namespace cloud {
+
+GLuint resolveProgram;
+
+// Two histories: the previous frame's is read while this frame's is written
+GLuint historyFBO;
+GLuint historyTex[2];
+int historyIndex = 0;
+glm::ivec2 historySize(0);
+bool historyValid = false;
+
+glm::mat4 prevViewProj;
+unsigned frameIndex = 0;
+
+GLuint resolveVAO;
+
+void initializeTemporal() {
+    resolveProgram = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/cloud_fullscreen.vert",
+                ":/resources/shaders/cloud_temporal.frag");
+
+    glGenTextures(2, historyTex);
+    for (GLuint tex : historyTex) {
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &historyFBO);
+    glGenVertexArrays(1, &resolveVAO);
+    historySize = glm::ivec2(0);
+    historyValid = false;
+}
+
+void finalizeTemporal() {
+    glDeleteVertexArrays(1, &resolveVAO);
+    glDeleteFramebuffers(1, &historyFBO);
+    glDeleteTextures(2, historyTex);
+    glDeleteProgram(resolveProgram);
+}
+
+void resetTemporal() {
+    historyValid = false;
+}
+
+// Base 2 radical inverse (van der Corput), the first dimension of the
+// Halton sequence
+static float halton2(unsigned i) {
+    float result = 0;
+    float digit = 0.5;
+    for (; i; i >>= 1, digit *= 0.5f) {
+        if (i & 1) result += digit;
+    }
+    return result;
+}
+
+float temporalJitter() {
+    return halton2(frameIndex % temporalJitterPeriod + 1);
+}
+
+GLuint resolveTemporal(GLuint colorTex, GLuint depthTex, glm::ivec2 size,
+                       const glm::mat4 &viewProj) {
+    if (size != historySize) {
+        for (GLuint tex : historyTex) {
+            glBindTexture(GL_TEXTURE_2D, tex);
+            // Half floats, so that small blend weights still move the history
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, size.x, size.y, 0,
+                         GL_RGBA, GL_HALF_FLOAT, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        historySize = size;
+        historyValid = false;
+    }
+
+    GLuint prevTex = historyTex[historyIndex];
+    historyIndex ^= 1;
+    GLuint nextTex = historyTex[historyIndex];
+
+    glBindFramebuffer(GL_FRAMEBUFFER, historyFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, nextTex, 0);
+    glViewport(0, 0, size.x, size.y);
+
+    glUseProgram(resolveProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, colorTex);
+    glUniform1i(glGetUniformLocation(resolveProgram, "currentTex"), 0);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, depthTex);
+    glUniform1i(glGetUniformLocation(resolveProgram, "currentDepth"), 1);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, prevTex);
+    glUniform1i(glGetUniformLocation(resolveProgram, "historyTex"), 2);
+
+    glm::mat4 invViewProj = glm::inverse(viewProj);
+    glUniformMatrix4fv(glGetUniformLocation(resolveProgram, "invViewProj"),
+                       1, GL_FALSE, &invViewProj[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(resolveProgram, "prevViewProj"),
+                       1, GL_FALSE, &prevViewProj[0][0]);
+    glUniform1i(glGetUniformLocation(resolveProgram, "historyValid"),
+                historyValid);
+    glUniform1f(glGetUniformLocation(resolveProgram, "blend"),
+                temporalBlend);
+    glUniform1f(glGetUniformLocation(resolveProgram, "clampGamma"),
+                temporalClampGamma);
+
+    // Overwrites the history, whatever the blend state
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(resolveVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+
+    for (GLenum unit : {GL_TEXTURE2, GL_TEXTURE1, GL_TEXTURE0}) {
+        glActiveTexture(unit);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glUseProgram(0);
+
+    prevViewProj = viewProj;
+    historyValid = true;
+    frameIndex++;
+
+    return nextTex;
+}
+
+}
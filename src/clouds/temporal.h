@@ -0,0 +1,25 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace cloud {
+// Accumulation of cloud frames over time. Each frame samples the clouds at
+// slightly different depths, and is blended into a history of the previous
+// frames, reprojected to the current camera.
+
+void initializeTemporal();
+void finalizeTemporal();
+
+// Forgets the history, e.g. when the clouds change
+void resetTemporal();
+
+// Offset in [0, 1) of this frame's samples, in units of the sample spacing
+float temporalJitter();
+
+// Blends the frame in colorTex (premultiplied, drawn with viewProj against
+// depthTex) with the history, and stores the result as the new history.
+// Returns the texture holding it. Advances to the next frame's jitter.
+GLuint resolveTemporal(GLuint colorTex, GLuint depthTex, glm::ivec2 size,
+                       const glm::mat4 &viewProj);
+}
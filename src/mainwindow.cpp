@@ -39,6 +39,15 @@ void MainWindow::initialize() {
     QLabel *skybox_label = new QLabel(); //  fog label
     skybox_label->setText("Skybox Type");
 
+    QLabel *cloud_res_label = new QLabel(); // cloud resolution label
+    cloud_res_label->setText("Cloud Resolution Divisor");
+
+    QLabel *cloud_noise_label = new QLabel(); // cloud noise resolution label
+    cloud_noise_label->setText("Cloud Noise Resolution");
+
+    QLabel *cloud_mode_label = new QLabel(); // cloud render mode label
+    cloud_mode_label->setText("Cloud Render Mode");
+
     QLabel *param1_label = new QLabel(); // Parameter 1 label
     param1_label->setText("Parameter 1:");
     QLabel *param2_label = new QLabel(); // Parameter 2 label
@@ -55,6 +64,39 @@ void MainWindow::initialize() {
     clouds_checkbox->setText(QStringLiteral("Clouds Toggle"));
     clouds_checkbox->setChecked(false);
 
+    // Create a choice of how the clouds are drawn, in the order of
+    // cloud::RenderMode
+    cloudModeBox = new QComboBox();
+    cloudModeBox->addItem(QStringLiteral("Cloud Slices"));
+    cloudModeBox->addItem(QStringLiteral("Ray-Marched Clouds"));
+    cloudModeBox->addItem(QStringLiteral("Shadowed Cloud Slices (Half-Angle)"));
+    cloudModeBox->setCurrentIndex(0);
+
+    // Create checkbox for temporally accumulated clouds
+    temporal_checkbox = new QCheckBox();
+    temporal_checkbox->setText(QStringLiteral("Temporal Cloud Accumulation"));
+    temporal_checkbox->setChecked(false);
+
+    // Create checkbox for slices blended front to back (instead of back to front)
+    fronttoback_checkbox = new QCheckBox();
+    fronttoback_checkbox->setText(QStringLiteral("Front-to-Back Cloud Slices"));
+    fronttoback_checkbox->setChecked(false);
+
+    // Create checkbox for clouds lit from a precomputed light volume
+    lightvolume_checkbox = new QCheckBox();
+    lightvolume_checkbox->setText(QStringLiteral("Precomputed Cloud Lighting"));
+    lightvolume_checkbox->setChecked(false);
+
+    // Create checkbox for clouds that move over time
+    animation_checkbox = new QCheckBox();
+    animation_checkbox->setText(QStringLiteral("Animate Clouds"));
+    animation_checkbox->setChecked(false);
+
+    // Create checkbox for GPU-tessellated terrain
+    tessellation_checkbox = new QCheckBox();
+    tessellation_checkbox->setText(QStringLiteral("Tessellated Terrain"));
+    tessellation_checkbox->setChecked(false);
+
     // Create file uploader for scene file
     uploadFile = new QPushButton();
     uploadFile->setText(QStringLiteral("Upload Scene File"));
@@ -203,6 +245,47 @@ void MainWindow::initialize() {
     sbl->addWidget(skyboxBox);
     skyboxLayout->setLayout(sbl);
 
+    QGroupBox *cloudResLayout = new QGroupBox(); // horizonal slider alignment
+    QHBoxLayout *crl = new QHBoxLayout();
+
+    // Clouds are drawn at 1 / divisor of the window's resolution
+    cloudResSlider = new QSlider(Qt::Orientation::Horizontal);
+    cloudResSlider->setTickInterval(1);
+    cloudResSlider->setMinimum(1);
+    cloudResSlider->setMaximum(4);
+    cloudResSlider->setValue(settings.cloudResolutionDivisor);
+
+    cloudResBox = new QSpinBox();
+    cloudResBox->setMinimum(1);
+    cloudResBox->setMaximum(4);
+    cloudResBox->setSingleStep(1);
+    cloudResBox->setValue(settings.cloudResolutionDivisor);
+
+    crl->addWidget(cloudResSlider);
+    crl->addWidget(cloudResBox);
+    cloudResLayout->setLayout(crl);
+
+    QGroupBox *cloudNoiseLayout = new QGroupBox(); // horizonal slider alignment
+    QHBoxLayout *cnl = new QHBoxLayout();
+
+    // Samples per side of the cloud noise, regenerated in the background
+    cloudNoiseSlider = new QSlider(Qt::Orientation::Horizontal);
+    cloudNoiseSlider->setTickInterval(16);
+    cloudNoiseSlider->setMinimum(16);
+    cloudNoiseSlider->setMaximum(128);
+    cloudNoiseSlider->setSingleStep(16);
+    cloudNoiseSlider->setValue(settings.cloudNoiseResolution);
+
+    cloudNoiseBox = new QSpinBox();
+    cloudNoiseBox->setMinimum(16);
+    cloudNoiseBox->setMaximum(128);
+    cloudNoiseBox->setSingleStep(16);
+    cloudNoiseBox->setValue(settings.cloudNoiseResolution);
+
+    cnl->addWidget(cloudNoiseSlider);
+    cnl->addWidget(cloudNoiseBox);
+    cloudNoiseLayout->setLayout(cnl);
+
 
 //    // Extra Credit:
 //    ec1 = new QCheckBox();
@@ -215,6 +298,7 @@ void MainWindow::initialize() {
     vLayout->addWidget(p1Layout);
     vLayout->addWidget(param2_label);
     vLayout->addWidget(p2Layout);
+    vLayout->addWidget(tessellation_checkbox);
     vLayout->addWidget(camera_label);
     vLayout->addWidget(near_label);
     vLayout->addWidget(nearLayout);
@@ -228,6 +312,16 @@ void MainWindow::initialize() {
     vLayout->addWidget(fogTypeLayout);
 
     vLayout->addWidget(clouds_checkbox);
+    vLayout->addWidget(cloud_mode_label);
+    vLayout->addWidget(cloudModeBox);
+    vLayout->addWidget(temporal_checkbox);
+    vLayout->addWidget(fronttoback_checkbox);
+    vLayout->addWidget(lightvolume_checkbox);
+    vLayout->addWidget(animation_checkbox);
+    vLayout->addWidget(cloud_res_label);
+    vLayout->addWidget(cloudResLayout);
+    vLayout->addWidget(cloud_noise_label);
+    vLayout->addWidget(cloudNoiseLayout);
     vLayout->addWidget(skybox_label);
     vLayout->addWidget(skyboxLayout);
     // Extra Credit:
@@ -261,6 +355,14 @@ void MainWindow::connectUIElements() {
     connectFogType();
     connectSkybox();
     connectCloudsToggle();
+    connectCloudRenderMode();
+    connectTemporalToggle();
+    connectFrontToBackToggle();
+    connectLightVolumeToggle();
+    connectAnimationToggle();
+    connectCloudResolution();
+    connectCloudNoiseResolution();
+    connectTessellationToggle();
 }
 
 
@@ -307,10 +409,47 @@ void MainWindow::connectSkybox() {
             this, &MainWindow::onValChangeSkybox);
 }
 
+void MainWindow::connectCloudResolution() {
+    connect(cloudResSlider, &QSlider::valueChanged, this, &MainWindow::onValChangeCloudResolution);
+    connect(cloudResBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeCloudResolution);
+}
+
+void MainWindow::connectCloudNoiseResolution() {
+    connect(cloudNoiseSlider, &QSlider::valueChanged, this, &MainWindow::onValChangeCloudNoiseResolution);
+    connect(cloudNoiseBox, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &MainWindow::onValChangeCloudNoiseResolution);
+}
+
 void MainWindow::connectCloudsToggle() {
     connect(clouds_checkbox, &QCheckBox::toggled, this, &MainWindow::onCloudsToggle);
 }
 
+void MainWindow::connectCloudRenderMode() {
+    connect(cloudModeBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onValChangeCloudRenderMode);
+}
+
+void MainWindow::connectTemporalToggle() {
+    connect(temporal_checkbox, &QCheckBox::toggled, this, &MainWindow::onTemporalToggle);
+}
+
+void MainWindow::connectFrontToBackToggle() {
+    connect(fronttoback_checkbox, &QCheckBox::toggled, this, &MainWindow::onFrontToBackToggle);
+}
+
+void MainWindow::connectLightVolumeToggle() {
+    connect(lightvolume_checkbox, &QCheckBox::toggled, this, &MainWindow::onLightVolumeToggle);
+}
+
+void MainWindow::connectAnimationToggle() {
+    connect(animation_checkbox, &QCheckBox::toggled, this, &MainWindow::onAnimationToggle);
+}
+
+void MainWindow::connectTessellationToggle() {
+    connect(tessellation_checkbox, &QCheckBox::toggled, this, &MainWindow::onTessellationToggle);
+}
+
 
 
 //void MainWindow::connectExtraCredit() {
@@ -325,6 +464,31 @@ void MainWindow::onCloudsToggle() {
     realtime->settingsChanged();
 }
 
+void MainWindow::onTemporalToggle() {
+    settings.cloudTemporal = !settings.cloudTemporal;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onFrontToBackToggle() {
+    settings.cloudFrontToBack = !settings.cloudFrontToBack;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onLightVolumeToggle() {
+    settings.cloudLightVolume = !settings.cloudLightVolume;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onAnimationToggle() {
+    settings.cloudAnimation = !settings.cloudAnimation;
+    realtime->settingsChanged();
+}
+
+void MainWindow::onTessellationToggle() {
+    settings.terrainTessellation = !settings.terrainTessellation;
+    realtime->settingsChanged();
+}
+
 void MainWindow::onUploadFile() {
     // Get abs path of scene file
     QString configFilePath = QFileDialog::getOpenFileName(this, tr("Upload File"), QDir::homePath(), tr("Scene Files (*.xml)"));
@@ -408,6 +572,25 @@ void MainWindow::onValChangeSkybox(int newValue) {
     realtime->settingsChanged();
 }
 
+void MainWindow::onValChangeCloudResolution(int newValue) {
+    cloudResSlider->setValue(newValue);
+    cloudResBox->setValue(newValue);
+    settings.cloudResolutionDivisor = cloudResSlider->value();
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeCloudNoiseResolution(int newValue) {
+    cloudNoiseSlider->setValue(newValue);
+    cloudNoiseBox->setValue(newValue);
+    settings.cloudNoiseResolution = cloudNoiseSlider->value();
+    realtime->settingsChanged();
+}
+
+void MainWindow::onValChangeCloudRenderMode(int index) {
+    settings.cloudRenderMode = index;
+    realtime->settingsChanged();
+}
+
 
 //// Extra Credit:
 
@@ -2,6 +2,7 @@
 
 #include <QMainWindow>
 #include <QCheckBox>
+#include <QComboBox>
 #include <QSlider>
 #include <QSpinBox>
 #include <QDoubleSpinBox>
@@ -27,9 +28,22 @@ private:
     void connectFogType();
     void connectSkybox();
     void connectCloudsToggle();
+    void connectCloudRenderMode();
+    void connectTemporalToggle();
+    void connectFrontToBackToggle();
+    void connectLightVolumeToggle();
+    void connectAnimationToggle();
+    void connectCloudResolution();
+    void connectCloudNoiseResolution();
+    void connectTessellationToggle();
 
     Realtime *realtime;
     QCheckBox *clouds_checkbox;
+    QCheckBox *temporal_checkbox;
+    QCheckBox *fronttoback_checkbox;
+    QCheckBox *lightvolume_checkbox;
+    QCheckBox *animation_checkbox;
+    QCheckBox *tessellation_checkbox;
     QPushButton *uploadFile;
     QSlider *p1Slider;
     QSlider *p2Slider;
@@ -46,12 +60,22 @@ private:
     QSpinBox *fogTypeBox;
     QSlider *skyboxSlider;
     QSpinBox *skyboxBox;
+    QSlider *cloudResSlider;
+    QSpinBox *cloudResBox;
+    QSlider *cloudNoiseSlider;
+    QSpinBox *cloudNoiseBox;
+    QComboBox *cloudModeBox;
 
     // Extra Credit:
     //QCheckBox *ec1;
 
 private slots:
     void onCloudsToggle();
+    void onTemporalToggle();
+    void onFrontToBackToggle();
+    void onLightVolumeToggle();
+    void onAnimationToggle();
+    void onTessellationToggle();
     //void onKernelBasedFilter();
     void onUploadFile();
     void onValChangeP1(int newValue);
@@ -64,5 +88,8 @@ private slots:
     void onValChangeFogBox(double newValue);
     void onValChangeFogType(int newValue);
     void onValChangeSkybox(int newValue);
+    void onValChangeCloudResolution(int newValue);
+    void onValChangeCloudNoiseResolution(int newValue);
+    void onValChangeCloudRenderMode(int index);
 
 };
@@ -0,0 +1,198 @@
+#include "perlin_impl.h"
+
+#include <algorithm>
+
+#if defined(NOISE_AVX2) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace noise {
+
+// Counter-based random numbers: the i-th number of a stream is a hash of
+// (seed, i), so entries can be computed independently and in any order, and
+// the tables come out the same on every platform. The mixing is the 32-bit
+// finalizer from MurmurHash3.
+static uint32_t hash(uint32_t seed, uint32_t counter) {
+    uint32_t h = seed * 0x9e3779b9u + counter;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
+}
+
+// Uniform float in [0, 1)
+static float unitFloat(uint32_t seed, uint32_t counter) {
+    return (hash(seed, counter) >> 8) * (1.0f / (1 << 24));
+}
+
+// Gradient component k of entry i uses counter 4 * i + k of the seed's
+// stream; the shuffle uses a second stream derived from the seed
+static void shufflePermutation(uint32_t seed, GradientTable &table) {
+    for (int i = 0; i < GradientTable::size; i++) {
+        table.perm[i] = i;
+    }
+    // Fisher-Yates
+    for (int i = GradientTable::size - 1; i > 0; i--) {
+        int j = hash(seed ^ 0x5bd1e995u, i) % (i + 1);
+        std::swap(table.perm[i], table.perm[j]);
+    }
+    for (int i = 0; i < GradientTable::size; i++) {
+        table.perm[GradientTable::size + i] = table.perm[i];
+    }
+}
+
+GradientTable GradientTable::make2D(uint32_t seed) {
+    GradientTable table;
+    shufflePermutation(seed, table);
+    for (int i = 0; i < size; i++) {
+        table.gx[i] = unitFloat(seed, 4 * i) * 2 - 1;
+        table.gy[i] = unitFloat(seed, 4 * i + 1) * 2 - 1;
+        table.gz[i] = 0;
+    }
+    return table;
+}
+
+GradientTable GradientTable::make3D(uint32_t seed) {
+    GradientTable table;
+    shufflePermutation(seed, table);
+    for (int i = 0; i < size; i++) {
+        float z = unitFloat(seed, 4 * i) * 2 - 1;
+        float phi = unitFloat(seed, 4 * i + 1) * 6.28318531f;
+        float r = std::sqrt(1 - z * z);
+        table.gx[i] = r * std::cos(phi);
+        table.gy[i] = r * std::sin(phi);
+        table.gz[i] = z;
+    }
+    return table;
+}
+
+namespace detail {
+
+int resolveOctaves(const Fbm &fbm, Octave *octaves) {
+    int numOctaves = std::min(fbm.octaves, maxOctaves);
+    float frequency = fbm.frequency;
+    float amplitude = fbm.amplitude;
+    for (int i = 0; i < numOctaves; i++) {
+        octaves[i].frequency = frequency;
+        octaves[i].amplitude = amplitude;
+        octaves[i].period = fbm.periodic ? (int)std::lround(frequency) : 0;
+        octaves[i].offset = (fbm.firstOctave + i) * 59;
+        frequency *= fbm.lacunarity;
+        amplitude *= fbm.gain;
+    }
+    return numOctaves;
+}
+
+}
+
+static Isa detectIsa() {
+#ifdef NOISE_AVX2
+#ifdef _MSC_VER
+    int regs[4];
+    __cpuid(regs, 1);
+    bool fma = regs[2] & (1 << 12);
+    bool osxsave = regs[2] & (1 << 27);
+    bool avx = regs[2] & (1 << 28);
+    __cpuidex(regs, 7, 0);
+    bool avx2 = regs[1] & (1 << 5);
+    // The OS must also save the YMM registers
+    if (fma && osxsave && avx && avx2 && (_xgetbv(0) & 6) == 6) {
+        return Isa::AVX2;
+    }
+#else
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return Isa::AVX2;
+    }
+#endif
+#endif
+#ifdef NOISE_SSE2
+    return Isa::SSE2;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+Isa activeIsa() {
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+const char *isaName(Isa isa) {
+    switch (isa) {
+    case Isa::AVX2:
+        return "AVX2";
+    case Isa::SSE2:
+        return "SSE2";
+    default:
+        return "scalar";
+    }
+}
+
+void fbm2(const GradientTable &table, const Fbm &fbm,
+          const float *x, const float *y, float *out, size_t n) {
+    detail::Octave octaves[detail::maxOctaves];
+    int numOctaves = detail::resolveOctaves(fbm, octaves);
+
+    switch (activeIsa()) {
+#ifdef NOISE_AVX2
+    case Isa::AVX2:
+        detail::fbm2Avx2(table, octaves, numOctaves, x, y, out, n);
+        return;
+#endif
+#ifdef NOISE_SSE2
+    case Isa::SSE2:
+        detail::fbm2Sse2(table, octaves, numOctaves, x, y, out, n);
+        return;
+#endif
+    default:
+        detail::fbm2Scalar(table, octaves, numOctaves, x, y, out, 0, n);
+    }
+}
+
+void fbm3(const GradientTable &table, const Fbm &fbm,
+          const float *x, const float *y, const float *z, float *out, size_t n) {
+    detail::Octave octaves[detail::maxOctaves];
+    int numOctaves = detail::resolveOctaves(fbm, octaves);
+
+    switch (activeIsa()) {
+#ifdef NOISE_AVX2
+    case Isa::AVX2:
+        detail::fbm3Avx2(table, octaves, numOctaves, x, y, z, out, n);
+        return;
+#endif
+#ifdef NOISE_SSE2
+    case Isa::SSE2:
+        detail::fbm3Sse2(table, octaves, numOctaves, x, y, z, out, n);
+        return;
+#endif
+    default:
+        detail::fbm3Scalar(table, octaves, numOctaves, x, y, z, out, 0, n);
+    }
+}
+
+void fbm3Grad(const GradientTable &table, const Fbm &fbm,
+              const float *x, const float *y, const float *z, float *out,
+              float *dx, float *dy, float *dz, size_t n) {
+    detail::Octave octaves[detail::maxOctaves];
+    int numOctaves = detail::resolveOctaves(fbm, octaves);
+
+    switch (activeIsa()) {
+#ifdef NOISE_AVX2
+    case Isa::AVX2:
+        detail::fbm3GradAvx2(table, octaves, numOctaves, x, y, z, out, dx, dy, dz, n);
+        return;
+#endif
+#ifdef NOISE_SSE2
+    case Isa::SSE2:
+        detail::fbm3GradSse2(table, octaves, numOctaves, x, y, z, out, dx, dy, dz, n);
+        return;
+#endif
+    default:
+        detail::fbm3GradScalar(table, octaves, numOctaves, x, y, z, out, dx, dy, dz, 0, n);
+    }
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Batch gradient (Perlin) noise shared by the terrain and the clouds.
+//
+// Every function evaluates n points at once. Internally, points are processed
+// 8 at a time with AVX2 or 4 at a time with SSE2, whichever the CPU supports,
+// and the remainder one by one.
+namespace noise {
+
+// Precomputed lattice data: a permutation of [0, size) that hashes lattice
+// coordinates, and one gradient per table entry.
+struct GradientTable {
+    static constexpr int size = 256;
+
+    // Stored twice so that perm[perm[x] + y] never needs wrapping
+    std::array<int32_t, 2 * size> perm;
+    std::array<float, size> gx;
+    std::array<float, size> gy;
+    std::array<float, size> gz;
+
+    // Gradients uniform in the square [-1, 1]^2 (gz is 0)
+    static GradientTable make2D(uint32_t seed);
+    // Gradients uniform on the unit sphere
+    static GradientTable make3D(uint32_t seed);
+};
+
+// Fractal sum of octaves. Octave i is sampled at frequency * lacunarity^i
+// and weighted by amplitude * gain^i.
+struct Fbm {
+    int octaves = 1;
+    float frequency = 1;
+    float amplitude = 1;
+    float lacunarity = 2;
+    float gain = 0.5;
+    // If set, the noise repeats every unit of input along each axis. Every
+    // octave's frequency must then be an integer. Otherwise it never repeats.
+    bool periodic = false;
+    // Octave i is hashed as octave firstOctave + i would be, so that octaves
+    // split across several fbms stay as different as in one
+    int firstOctave = 0;
+};
+
+enum class Isa { Scalar, SSE2, AVX2 };
+
+// Instruction set the batch functions dispatch to on this CPU
+Isa activeIsa();
+const char *isaName(Isa isa);
+
+// out[i] = fbm(x[i], y[i])
+void fbm2(const GradientTable &table, const Fbm &fbm,
+          const float *x, const float *y, float *out, size_t n);
+
+// out[i] = fbm(x[i], y[i], z[i])
+void fbm3(const GradientTable &table, const Fbm &fbm,
+          const float *x, const float *y, const float *z, float *out, size_t n);
+
+// As fbm3, also writing the exact gradient of fbm at each point to
+// (dx[i], dy[i], dz[i]) from the same evaluation
+void fbm3Grad(const GradientTable &table, const Fbm &fbm,
+              const float *x, const float *y, const float *z, float *out,
+              float *dx, float *dy, float *dz, size_t n);
+
+}
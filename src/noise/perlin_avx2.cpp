@@ -0,0 +1,286 @@
+#include "perlin_impl.h"
+
+// 8-wide kernels. The build compiles this file alone with AVX2 and FMA
+// enabled and defines NOISE_AVX2; fbm2()/fbm3() only call into it after
+// checking that the CPU supports both.
+#ifdef NOISE_AVX2
+
+#include <immintrin.h>
+
+namespace noise::detail {
+
+namespace {
+
+inline __m256i gather8(const int32_t *table, __m256i index) {
+    return _mm256_i32gather_epi32(table, index, 4);
+}
+
+inline __m256 gather8(const float *table, __m256i index) {
+    return _mm256_i32gather_ps(table, index, 4);
+}
+
+inline __m256 fade8(__m256 t) {
+    __m256 t2 = _mm256_mul_ps(t, t);
+    return _mm256_mul_ps(t2, _mm256_fnmadd_ps(_mm256_set1_ps(2), t, _mm256_set1_ps(3)));
+}
+
+// 6 t (1 - t)
+inline __m256 fadeDerivative8(__m256 t) {
+    return _mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(6), t),
+                         _mm256_sub_ps(_mm256_set1_ps(1), t));
+}
+
+inline __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+    return _mm256_fmadd_ps(t, _mm256_sub_ps(b, a), a);
+}
+
+inline __m256 trilerp8(const __m256 *c, __m256 u, __m256 v, __m256 w) {
+    return lerp8(lerp8(lerp8(c[0], c[1], u), lerp8(c[2], c[3], u), v),
+                 lerp8(lerp8(c[4], c[5], u), lerp8(c[6], c[7], u), v), w);
+}
+
+// Vector version of hashLattice()
+inline __m256i hashLattice8(__m256i i) {
+    __m256i h = _mm256_mullo_epi32(i, _mm256_set1_epi32((int)latticeHash1));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int)latticeHash2));
+    return _mm256_srli_epi32(h, 24);
+}
+
+// Vector version of latticeIndex() for the cell cornerf and the next one
+inline void lattice8(__m256 cornerf, int period, int offset, __m256i &i0, __m256i &i1) {
+    __m256 c0 = cornerf;
+    __m256 c1 = _mm256_add_ps(cornerf, _mm256_set1_ps(1));
+    __m256i off = _mm256_set1_epi32(offset);
+    if (!period) {
+        i0 = hashLattice8(_mm256_add_epi32(_mm256_cvttps_epi32(c0), off));
+        i1 = hashLattice8(_mm256_add_epi32(_mm256_cvttps_epi32(c1), off));
+        return;
+    }
+    __m256 p = _mm256_set1_ps((float)period);
+    c0 = _mm256_fnmadd_ps(p, _mm256_floor_ps(_mm256_div_ps(c0, p)), c0);
+    c1 = _mm256_add_ps(c0, _mm256_set1_ps(1));
+    c1 = _mm256_andnot_ps(_mm256_cmp_ps(c1, p, _CMP_EQ_OQ), c1);
+    __m256i m = _mm256_set1_epi32(mask);
+    i0 = _mm256_and_si256(_mm256_add_epi32(_mm256_cvttps_epi32(c0), off), m);
+    i1 = _mm256_and_si256(_mm256_add_epi32(_mm256_cvttps_epi32(c1), off), m);
+}
+
+inline __m256 dot2(const GradientTable &t, __m256i h, __m256 x, __m256 y) {
+    return _mm256_fmadd_ps(gather8(t.gx.data(), h), x,
+                           _mm256_mul_ps(gather8(t.gy.data(), h), y));
+}
+
+inline __m256 dot3(const GradientTable &t, __m256i h, __m256 x, __m256 y, __m256 z) {
+    return _mm256_fmadd_ps(gather8(t.gx.data(), h), x,
+                           _mm256_fmadd_ps(gather8(t.gy.data(), h), y,
+                                           _mm256_mul_ps(gather8(t.gz.data(), h), z)));
+}
+
+}
+
+void fbm2Avx2(const GradientTable &t, const Octave *octaves, int numOctaves,
+              const float *x, const float *y, float *out, size_t n) {
+    const int32_t *perm = t.perm.data();
+    __m256 one = _mm256_set1_ps(1);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 sum = _mm256_setzero_ps();
+
+        for (int o = 0; o < numOctaves; o++) {
+            const Octave &oct = octaves[o];
+            __m256 freq = _mm256_set1_ps(oct.frequency);
+            __m256 sx = _mm256_mul_ps(px, freq);
+            __m256 sy = _mm256_mul_ps(py, freq);
+            __m256 xf = _mm256_floor_ps(sx);
+            __m256 yf = _mm256_floor_ps(sy);
+            __m256 fx = _mm256_sub_ps(sx, xf);
+            __m256 fy = _mm256_sub_ps(sy, yf);
+
+            __m256i X0, X1, Y0, Y1;
+            lattice8(xf, oct.period, oct.offset, X0, X1);
+            lattice8(yf, oct.period, 0, Y0, Y1);
+
+            __m256i hA = gather8(perm, X0);
+            __m256i hB = gather8(perm, X1);
+            __m256i h00 = gather8(perm, _mm256_add_epi32(hA, Y0));
+            __m256i h10 = gather8(perm, _mm256_add_epi32(hB, Y0));
+            __m256i h01 = gather8(perm, _mm256_add_epi32(hA, Y1));
+            __m256i h11 = gather8(perm, _mm256_add_epi32(hB, Y1));
+
+            __m256 fx1 = _mm256_sub_ps(fx, one);
+            __m256 fy1 = _mm256_sub_ps(fy, one);
+            __m256 d00 = dot2(t, h00, fx, fy);
+            __m256 d10 = dot2(t, h10, fx1, fy);
+            __m256 d01 = dot2(t, h01, fx, fy1);
+            __m256 d11 = dot2(t, h11, fx1, fy1);
+
+            __m256 u = fade8(fx);
+            __m256 v = fade8(fy);
+            __m256 value = lerp8(lerp8(d00, d10, u), lerp8(d01, d11, u), v);
+            sum = _mm256_fmadd_ps(_mm256_set1_ps(oct.amplitude), value, sum);
+        }
+        _mm256_storeu_ps(out + i, sum);
+    }
+    fbm2Scalar(t, octaves, numOctaves, x, y, out, i, n);
+}
+
+void fbm3Avx2(const GradientTable &t, const Octave *octaves, int numOctaves,
+              const float *x, const float *y, const float *z, float *out, size_t n) {
+    const int32_t *perm = t.perm.data();
+    __m256 one = _mm256_set1_ps(1);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 pz = _mm256_loadu_ps(z + i);
+        __m256 sum = _mm256_setzero_ps();
+
+        for (int o = 0; o < numOctaves; o++) {
+            const Octave &oct = octaves[o];
+            __m256 freq = _mm256_set1_ps(oct.frequency);
+            __m256 sx = _mm256_mul_ps(px, freq);
+            __m256 sy = _mm256_mul_ps(py, freq);
+            __m256 sz = _mm256_mul_ps(pz, freq);
+            __m256 xf = _mm256_floor_ps(sx);
+            __m256 yf = _mm256_floor_ps(sy);
+            __m256 zf = _mm256_floor_ps(sz);
+            __m256 fx = _mm256_sub_ps(sx, xf);
+            __m256 fy = _mm256_sub_ps(sy, yf);
+            __m256 fz = _mm256_sub_ps(sz, zf);
+
+            __m256i X0, X1, Y0, Y1, Z0, Z1;
+            lattice8(xf, oct.period, oct.offset, X0, X1);
+            lattice8(yf, oct.period, 0, Y0, Y1);
+            lattice8(zf, oct.period, 0, Z0, Z1);
+
+            __m256i hA = gather8(perm, X0);
+            __m256i hB = gather8(perm, X1);
+            __m256i hAA = gather8(perm, _mm256_add_epi32(hA, Y0));
+            __m256i hBA = gather8(perm, _mm256_add_epi32(hB, Y0));
+            __m256i hAB = gather8(perm, _mm256_add_epi32(hA, Y1));
+            __m256i hBB = gather8(perm, _mm256_add_epi32(hB, Y1));
+
+            __m256 fx1 = _mm256_sub_ps(fx, one);
+            __m256 fy1 = _mm256_sub_ps(fy, one);
+            __m256 fz1 = _mm256_sub_ps(fz, one);
+            __m256 d000 = dot3(t, gather8(perm, _mm256_add_epi32(hAA, Z0)), fx,  fy,  fz);
+            __m256 d100 = dot3(t, gather8(perm, _mm256_add_epi32(hBA, Z0)), fx1, fy,  fz);
+            __m256 d010 = dot3(t, gather8(perm, _mm256_add_epi32(hAB, Z0)), fx,  fy1, fz);
+            __m256 d110 = dot3(t, gather8(perm, _mm256_add_epi32(hBB, Z0)), fx1, fy1, fz);
+            __m256 d001 = dot3(t, gather8(perm, _mm256_add_epi32(hAA, Z1)), fx,  fy,  fz1);
+            __m256 d101 = dot3(t, gather8(perm, _mm256_add_epi32(hBA, Z1)), fx1, fy,  fz1);
+            __m256 d011 = dot3(t, gather8(perm, _mm256_add_epi32(hAB, Z1)), fx,  fy1, fz1);
+            __m256 d111 = dot3(t, gather8(perm, _mm256_add_epi32(hBB, Z1)), fx1, fy1, fz1);
+
+            __m256 u = fade8(fx);
+            __m256 v = fade8(fy);
+            __m256 w = fade8(fz);
+            __m256 value = lerp8(lerp8(lerp8(d000, d100, u), lerp8(d010, d110, u), v),
+                                 lerp8(lerp8(d001, d101, u), lerp8(d011, d111, u), v), w);
+            sum = _mm256_fmadd_ps(_mm256_set1_ps(oct.amplitude), value, sum);
+        }
+        _mm256_storeu_ps(out + i, sum);
+    }
+    fbm3Scalar(t, octaves, numOctaves, x, y, z, out, i, n);
+}
+
+void fbm3GradAvx2(const GradientTable &t, const Octave *octaves, int numOctaves,
+                  const float *x, const float *y, const float *z, float *out,
+                  float *dx, float *dy, float *dz, size_t n) {
+    const int32_t *perm = t.perm.data();
+    __m256 one = _mm256_set1_ps(1);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 pz = _mm256_loadu_ps(z + i);
+        __m256 sum = _mm256_setzero_ps();
+        __m256 sumX = _mm256_setzero_ps();
+        __m256 sumY = _mm256_setzero_ps();
+        __m256 sumZ = _mm256_setzero_ps();
+
+        for (int o = 0; o < numOctaves; o++) {
+            const Octave &oct = octaves[o];
+            __m256 freq = _mm256_set1_ps(oct.frequency);
+            __m256 sx = _mm256_mul_ps(px, freq);
+            __m256 sy = _mm256_mul_ps(py, freq);
+            __m256 sz = _mm256_mul_ps(pz, freq);
+            __m256 xf = _mm256_floor_ps(sx);
+            __m256 yf = _mm256_floor_ps(sy);
+            __m256 zf = _mm256_floor_ps(sz);
+            __m256 fx = _mm256_sub_ps(sx, xf);
+            __m256 fy = _mm256_sub_ps(sy, yf);
+            __m256 fz = _mm256_sub_ps(sz, zf);
+
+            __m256i X0, X1, Y0, Y1, Z0, Z1;
+            lattice8(xf, oct.period, oct.offset, X0, X1);
+            lattice8(yf, oct.period, 0, Y0, Y1);
+            lattice8(zf, oct.period, 0, Z0, Z1);
+
+            __m256i hA = gather8(perm, X0);
+            __m256i hB = gather8(perm, X1);
+            __m256i hAA = gather8(perm, _mm256_add_epi32(hA, Y0));
+            __m256i hBA = gather8(perm, _mm256_add_epi32(hB, Y0));
+            __m256i hAB = gather8(perm, _mm256_add_epi32(hA, Y1));
+            __m256i hBB = gather8(perm, _mm256_add_epi32(hB, Y1));
+            __m256i h[8] = {
+                gather8(perm, _mm256_add_epi32(hAA, Z0)), gather8(perm, _mm256_add_epi32(hBA, Z0)),
+                gather8(perm, _mm256_add_epi32(hAB, Z0)), gather8(perm, _mm256_add_epi32(hBB, Z0)),
+                gather8(perm, _mm256_add_epi32(hAA, Z1)), gather8(perm, _mm256_add_epi32(hBA, Z1)),
+                gather8(perm, _mm256_add_epi32(hAB, Z1)), gather8(perm, _mm256_add_epi32(hBB, Z1)),
+            };
+
+            __m256 fx1 = _mm256_sub_ps(fx, one);
+            __m256 fy1 = _mm256_sub_ps(fy, one);
+            __m256 fz1 = _mm256_sub_ps(fz, one);
+            __m256 gx[8], gy[8], gz[8], d[8];
+            for (int c = 0; c < 8; c++) {
+                gx[c] = gather8(t.gx.data(), h[c]);
+                gy[c] = gather8(t.gy.data(), h[c]);
+                gz[c] = gather8(t.gz.data(), h[c]);
+                d[c] = _mm256_fmadd_ps(gx[c], c & 1 ? fx1 : fx,
+                                       _mm256_fmadd_ps(gy[c], c & 2 ? fy1 : fy,
+                                                       _mm256_mul_ps(gz[c], c & 4 ? fz1 : fz)));
+            }
+
+            __m256 u = fade8(fx);
+            __m256 v = fade8(fy);
+            __m256 w = fade8(fz);
+            // As perlin3Grad
+            __m256 x0 = lerp8(lerp8(d[0], d[2], v), lerp8(d[4], d[6], v), w);
+            __m256 x1 = lerp8(lerp8(d[1], d[3], v), lerp8(d[5], d[7], v), w);
+            __m256 y0 = lerp8(lerp8(d[0], d[1], u), lerp8(d[4], d[5], u), w);
+            __m256 y1 = lerp8(lerp8(d[2], d[3], u), lerp8(d[6], d[7], u), w);
+            __m256 z0 = lerp8(lerp8(d[0], d[1], u), lerp8(d[2], d[3], u), v);
+            __m256 z1 = lerp8(lerp8(d[4], d[5], u), lerp8(d[6], d[7], u), v);
+            __m256 gradX = _mm256_fmadd_ps(fadeDerivative8(fx), _mm256_sub_ps(x1, x0),
+                                           trilerp8(gx, u, v, w));
+            __m256 gradY = _mm256_fmadd_ps(fadeDerivative8(fy), _mm256_sub_ps(y1, y0),
+                                           trilerp8(gy, u, v, w));
+            __m256 gradZ = _mm256_fmadd_ps(fadeDerivative8(fz), _mm256_sub_ps(z1, z0),
+                                           trilerp8(gz, u, v, w));
+
+            __m256 amp = _mm256_set1_ps(oct.amplitude);
+            __m256 gradAmp = _mm256_set1_ps(oct.amplitude * oct.frequency);
+            sum = _mm256_fmadd_ps(amp, lerp8(z0, z1, w), sum);
+            sumX = _mm256_fmadd_ps(gradAmp, gradX, sumX);
+            sumY = _mm256_fmadd_ps(gradAmp, gradY, sumY);
+            sumZ = _mm256_fmadd_ps(gradAmp, gradZ, sumZ);
+        }
+        _mm256_storeu_ps(out + i, sum);
+        _mm256_storeu_ps(dx + i, sumX);
+        _mm256_storeu_ps(dy + i, sumY);
+        _mm256_storeu_ps(dz + i, sumZ);
+    }
+    fbm3GradScalar(t, octaves, numOctaves, x, y, z, out, dx, dy, dz, i, n);
+}
+
+}
+
+#endif
@@ -0,0 +1,281 @@
+#pragma once
+
+// Internal to the noise library: scalar reference kernels (also used for the
+// tails of SIMD batches) and the per-ISA batch kernels.
+
+#include <cmath>
+#include <cstdint>
+
+#include "perlin.h"
+
+namespace noise::detail {
+
+constexpr int mask = GradientTable::size - 1;
+
+// One octave of an Fbm, resolved to the values the kernels need
+struct Octave {
+    float frequency;
+    float amplitude;
+    int period; // lattice period, 0 if not periodic
+    int offset; // added to lattice x so that octaves hash differently
+};
+
+constexpr int maxOctaves = 16;
+
+// Fills octaves from fbm and returns how many there are
+int resolveOctaves(const Fbm &fbm, Octave *octaves);
+
+// With internal linkage, so that each file keeps the copy compiled for its
+// own instruction set: the linker could otherwise pick perlin_avx2.cpp's
+// copy for every caller
+namespace {
+
+inline float fade(float t) {
+    return t * t * (3 - 2 * t);
+}
+
+// d fade(t) / dt
+inline float fadeDerivative(float t) {
+    return 6 * t * (1 - t);
+}
+
+inline float lerp(float a, float b, float t) {
+    return a + t * (b - a);
+}
+
+// Trilinear blend of values at a cell's corners, ordered 000, 100, 010, 110,
+// 001, 101, 011, 111 (x fastest)
+inline float trilerp(const float *c, float u, float v, float w) {
+    return lerp(lerp(lerp(c[0], c[1], u), lerp(c[2], c[3], u), v),
+                lerp(lerp(c[4], c[5], u), lerp(c[6], c[7], u), v), w);
+}
+
+// Multiplies and shifts a whole lattice coordinate down to the table's
+// range, so that where the noise is not periodic the lattice does not repeat
+// every table size either. The constants are odd, and the top byte of the
+// product depends on every bit of i.
+constexpr uint32_t latticeHash1 = 0x9e3779b1;
+constexpr uint32_t latticeHash2 = 0x85ebca6b;
+
+inline int hashLattice(int i) {
+    uint32_t h = (uint32_t)i * latticeHash1;
+    h ^= h >> 16;
+    h *= latticeHash2;
+    return (int)(h >> 24);
+}
+
+// Lattice index wrapped to the period and masked into the table's range, or
+// without a period, hashed into it
+inline int latticeIndex(int i, int period, int offset) {
+    if (!period) {
+        return hashLattice(i + offset);
+    }
+    i %= period;
+    if (i < 0) i += period;
+    return (i + offset) & mask;
+}
+
+inline float perlin2(const GradientTable &t, const Octave &o, float x, float y) {
+    x *= o.frequency;
+    y *= o.frequency;
+    float xf = std::floor(x);
+    float yf = std::floor(y);
+    int X = (int)xf;
+    int Y = (int)yf;
+    int X0 = latticeIndex(X, o.period, o.offset);
+    int X1 = latticeIndex(X + 1, o.period, o.offset);
+    int Y0 = latticeIndex(Y, o.period, 0);
+    int Y1 = latticeIndex(Y + 1, o.period, 0);
+    float fx = x - xf;
+    float fy = y - yf;
+
+    int hA = t.perm[X0];
+    int hB = t.perm[X1];
+    int h00 = t.perm[hA + Y0];
+    int h10 = t.perm[hB + Y0];
+    int h01 = t.perm[hA + Y1];
+    int h11 = t.perm[hB + Y1];
+
+    float d00 = t.gx[h00] * fx + t.gy[h00] * fy;
+    float d10 = t.gx[h10] * (fx - 1) + t.gy[h10] * fy;
+    float d01 = t.gx[h01] * fx + t.gy[h01] * (fy - 1);
+    float d11 = t.gx[h11] * (fx - 1) + t.gy[h11] * (fy - 1);
+
+    float u = fade(fx);
+    float v = fade(fy);
+    return lerp(lerp(d00, d10, u), lerp(d01, d11, u), v);
+}
+
+inline float grad3(const GradientTable &t, int h, float x, float y, float z) {
+    return t.gx[h] * x + t.gy[h] * y + t.gz[h] * z;
+}
+
+inline float perlin3(const GradientTable &t, const Octave &o, float x, float y, float z) {
+    x *= o.frequency;
+    y *= o.frequency;
+    z *= o.frequency;
+    float xf = std::floor(x);
+    float yf = std::floor(y);
+    float zf = std::floor(z);
+    int X = (int)xf;
+    int Y = (int)yf;
+    int Z = (int)zf;
+    int X0 = latticeIndex(X, o.period, o.offset);
+    int X1 = latticeIndex(X + 1, o.period, o.offset);
+    int Y0 = latticeIndex(Y, o.period, 0);
+    int Y1 = latticeIndex(Y + 1, o.period, 0);
+    int Z0 = latticeIndex(Z, o.period, 0);
+    int Z1 = latticeIndex(Z + 1, o.period, 0);
+    float fx = x - xf;
+    float fy = y - yf;
+    float fz = z - zf;
+
+    int hA = t.perm[X0];
+    int hB = t.perm[X1];
+    int hAA = t.perm[hA + Y0];
+    int hBA = t.perm[hB + Y0];
+    int hAB = t.perm[hA + Y1];
+    int hBB = t.perm[hB + Y1];
+
+    float d000 = grad3(t, t.perm[hAA + Z0], fx,     fy,     fz);
+    float d100 = grad3(t, t.perm[hBA + Z0], fx - 1, fy,     fz);
+    float d010 = grad3(t, t.perm[hAB + Z0], fx,     fy - 1, fz);
+    float d110 = grad3(t, t.perm[hBB + Z0], fx - 1, fy - 1, fz);
+    float d001 = grad3(t, t.perm[hAA + Z1], fx,     fy,     fz - 1);
+    float d101 = grad3(t, t.perm[hBA + Z1], fx - 1, fy,     fz - 1);
+    float d011 = grad3(t, t.perm[hAB + Z1], fx,     fy - 1, fz - 1);
+    float d111 = grad3(t, t.perm[hBB + Z1], fx - 1, fy - 1, fz - 1);
+
+    float u = fade(fx);
+    float v = fade(fy);
+    float w = fade(fz);
+    return lerp(lerp(lerp(d000, d100, u), lerp(d010, d110, u), v),
+                lerp(lerp(d001, d101, u), lerp(d011, d111, u), v), w);
+}
+
+// perlin3, also writing its gradient with respect to (x, y, z) to grad
+inline float perlin3Grad(const GradientTable &t, const Octave &o,
+                         float x, float y, float z, float *grad) {
+    x *= o.frequency;
+    y *= o.frequency;
+    z *= o.frequency;
+    float xf = std::floor(x);
+    float yf = std::floor(y);
+    float zf = std::floor(z);
+    int X = (int)xf;
+    int Y = (int)yf;
+    int Z = (int)zf;
+    int X0 = latticeIndex(X, o.period, o.offset);
+    int X1 = latticeIndex(X + 1, o.period, o.offset);
+    int Y0 = latticeIndex(Y, o.period, 0);
+    int Y1 = latticeIndex(Y + 1, o.period, 0);
+    int Z0 = latticeIndex(Z, o.period, 0);
+    int Z1 = latticeIndex(Z + 1, o.period, 0);
+    float fx = x - xf;
+    float fy = y - yf;
+    float fz = z - zf;
+
+    int hA = t.perm[X0];
+    int hB = t.perm[X1];
+    int hAA = t.perm[hA + Y0];
+    int hBA = t.perm[hB + Y0];
+    int hAB = t.perm[hA + Y1];
+    int hBB = t.perm[hB + Y1];
+    int h[8] = {t.perm[hAA + Z0], t.perm[hBA + Z0], t.perm[hAB + Z0], t.perm[hBB + Z0],
+                t.perm[hAA + Z1], t.perm[hBA + Z1], t.perm[hAB + Z1], t.perm[hBB + Z1]};
+
+    float gx[8], gy[8], gz[8], d[8];
+    for (int c = 0; c < 8; c++) {
+        gx[c] = t.gx[h[c]];
+        gy[c] = t.gy[h[c]];
+        gz[c] = t.gz[h[c]];
+        d[c] = gx[c] * (fx - (c & 1)) + gy[c] * (fy - (c >> 1 & 1)) + gz[c] * (fz - (c >> 2));
+    }
+
+    float u = fade(fx);
+    float v = fade(fy);
+    float w = fade(fz);
+    // The blend of the corners' gradients, plus the change in their weights
+    float x0 = lerp(lerp(d[0], d[2], v), lerp(d[4], d[6], v), w);
+    float x1 = lerp(lerp(d[1], d[3], v), lerp(d[5], d[7], v), w);
+    float y0 = lerp(lerp(d[0], d[1], u), lerp(d[4], d[5], u), w);
+    float y1 = lerp(lerp(d[2], d[3], u), lerp(d[6], d[7], u), w);
+    float z0 = lerp(lerp(d[0], d[1], u), lerp(d[2], d[3], u), v);
+    float z1 = lerp(lerp(d[4], d[5], u), lerp(d[6], d[7], u), v);
+    grad[0] = o.frequency * (trilerp(gx, u, v, w) + fadeDerivative(fx) * (x1 - x0));
+    grad[1] = o.frequency * (trilerp(gy, u, v, w) + fadeDerivative(fy) * (y1 - y0));
+    grad[2] = o.frequency * (trilerp(gz, u, v, w) + fadeDerivative(fz) * (z1 - z0));
+    return lerp(z0, z1, w);
+}
+
+// Scalar batch kernels over [begin, n)
+inline void fbm2Scalar(const GradientTable &t, const Octave *octaves, int numOctaves,
+                       const float *x, const float *y, float *out,
+                       size_t begin, size_t n) {
+    for (size_t i = begin; i < n; i++) {
+        float sum = 0;
+        for (int o = 0; o < numOctaves; o++) {
+            sum += octaves[o].amplitude * perlin2(t, octaves[o], x[i], y[i]);
+        }
+        out[i] = sum;
+    }
+}
+
+inline void fbm3Scalar(const GradientTable &t, const Octave *octaves, int numOctaves,
+                       const float *x, const float *y, const float *z, float *out,
+                       size_t begin, size_t n) {
+    for (size_t i = begin; i < n; i++) {
+        float sum = 0;
+        for (int o = 0; o < numOctaves; o++) {
+            sum += octaves[o].amplitude * perlin3(t, octaves[o], x[i], y[i], z[i]);
+        }
+        out[i] = sum;
+    }
+}
+
+inline void fbm3GradScalar(const GradientTable &t, const Octave *octaves, int numOctaves,
+                           const float *x, const float *y, const float *z, float *out,
+                           float *dx, float *dy, float *dz, size_t begin, size_t n) {
+    for (size_t i = begin; i < n; i++) {
+        float sum = 0;
+        float grad[3] = {0, 0, 0};
+        for (int o = 0; o < numOctaves; o++) {
+            float octaveGrad[3];
+            sum += octaves[o].amplitude
+                    * perlin3Grad(t, octaves[o], x[i], y[i], z[i], octaveGrad);
+            for (int a = 0; a < 3; a++) {
+                grad[a] += octaves[o].amplitude * octaveGrad[a];
+            }
+        }
+        out[i] = sum;
+        dx[i] = grad[0];
+        dy[i] = grad[1];
+        dz[i] = grad[2];
+    }
+}
+
+}
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NOISE_SSE2
+void fbm2Sse2(const GradientTable &t, const Octave *octaves, int numOctaves,
+              const float *x, const float *y, float *out, size_t n);
+void fbm3Sse2(const GradientTable &t, const Octave *octaves, int numOctaves,
+              const float *x, const float *y, const float *z, float *out, size_t n);
+void fbm3GradSse2(const GradientTable &t, const Octave *octaves, int numOctaves,
+                  const float *x, const float *y, const float *z, float *out,
+                  float *dx, float *dy, float *dz, size_t n);
+#endif
+
+// NOISE_AVX2 is defined by the build when perlin_avx2.cpp is compiled for AVX2
+#ifdef NOISE_AVX2
+void fbm2Avx2(const GradientTable &t, const Octave *octaves, int numOctaves,
+              const float *x, const float *y, float *out, size_t n);
+void fbm3Avx2(const GradientTable &t, const Octave *octaves, int numOctaves,
+              const float *x, const float *y, const float *z, float *out, size_t n);
+void fbm3GradAvx2(const GradientTable &t, const Octave *octaves, int numOctaves,
+                  const float *x, const float *y, const float *z, float *out,
+                  float *dx, float *dy, float *dz, size_t n);
+#endif
+
+}
@@ -0,0 +1,304 @@
+#include "perlin_impl.h"
+
+// 4-wide kernels. SSE2 is part of the x86-64 baseline, so this file needs no
+// extra compiler flags; on other architectures it compiles to nothing.
+#ifdef NOISE_SSE2
+
+#include <emmintrin.h>
+
+namespace noise::detail {
+
+namespace {
+
+// SSE2 has no floor instruction: truncate, then step down where that rounded up
+inline __m128 floor4(__m128 x) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1)));
+}
+
+// SSE2 has no gathers either
+inline __m128i gather4(const int32_t *table, __m128i index) {
+    alignas(16) int32_t i[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(i), index);
+    return _mm_setr_epi32(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+}
+
+inline __m128 gather4(const float *table, __m128i index) {
+    alignas(16) int32_t i[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(i), index);
+    return _mm_setr_ps(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+}
+
+inline __m128 fade4(__m128 t) {
+    __m128 t2 = _mm_mul_ps(t, t);
+    return _mm_mul_ps(t2, _mm_sub_ps(_mm_set1_ps(3), _mm_add_ps(t, t)));
+}
+
+// 6 t (1 - t)
+inline __m128 fadeDerivative4(__m128 t) {
+    return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(6), t), _mm_sub_ps(_mm_set1_ps(1), t));
+}
+
+inline __m128 lerp4(__m128 a, __m128 b, __m128 t) {
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+inline __m128 trilerp4(const __m128 *c, __m128 u, __m128 v, __m128 w) {
+    return lerp4(lerp4(lerp4(c[0], c[1], u), lerp4(c[2], c[3], u), v),
+                 lerp4(lerp4(c[4], c[5], u), lerp4(c[6], c[7], u), v), w);
+}
+
+// SSE2 has no 32-bit multiply that keeps the low halves: multiply the even
+// and odd lanes into 64 bits, and put the low halves back together
+inline __m128i mullo4(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Vector version of hashLattice()
+inline __m128i hashLattice4(__m128i i) {
+    __m128i h = mullo4(i, _mm_set1_epi32((int)latticeHash1));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+    h = mullo4(h, _mm_set1_epi32((int)latticeHash2));
+    return _mm_srli_epi32(h, 24);
+}
+
+// Vector version of latticeIndex() for the cell cornerf and the next one
+inline void lattice4(__m128 cornerf, int period, int offset, __m128i &i0, __m128i &i1) {
+    __m128 c0 = cornerf;
+    __m128 c1 = _mm_add_ps(cornerf, _mm_set1_ps(1));
+    __m128i off = _mm_set1_epi32(offset);
+    if (!period) {
+        i0 = hashLattice4(_mm_add_epi32(_mm_cvttps_epi32(c0), off));
+        i1 = hashLattice4(_mm_add_epi32(_mm_cvttps_epi32(c1), off));
+        return;
+    }
+    __m128 p = _mm_set1_ps((float)period);
+    c0 = _mm_sub_ps(c0, _mm_mul_ps(p, floor4(_mm_div_ps(c0, p))));
+    c1 = _mm_add_ps(c0, _mm_set1_ps(1));
+    c1 = _mm_andnot_ps(_mm_cmpeq_ps(c1, p), c1);
+    __m128i m = _mm_set1_epi32(mask);
+    i0 = _mm_and_si128(_mm_add_epi32(_mm_cvttps_epi32(c0), off), m);
+    i1 = _mm_and_si128(_mm_add_epi32(_mm_cvttps_epi32(c1), off), m);
+}
+
+inline __m128 dot2(const GradientTable &t, __m128i h, __m128 x, __m128 y) {
+    return _mm_add_ps(_mm_mul_ps(gather4(t.gx.data(), h), x),
+                      _mm_mul_ps(gather4(t.gy.data(), h), y));
+}
+
+inline __m128 dot3(const GradientTable &t, __m128i h, __m128 x, __m128 y, __m128 z) {
+    return _mm_add_ps(_mm_add_ps(_mm_mul_ps(gather4(t.gx.data(), h), x),
+                                 _mm_mul_ps(gather4(t.gy.data(), h), y)),
+                      _mm_mul_ps(gather4(t.gz.data(), h), z));
+}
+
+}
+
+void fbm2Sse2(const GradientTable &t, const Octave *octaves, int numOctaves,
+              const float *x, const float *y, float *out, size_t n) {
+    const int32_t *perm = t.perm.data();
+    __m128 one = _mm_set1_ps(1);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 sum = _mm_setzero_ps();
+
+        for (int o = 0; o < numOctaves; o++) {
+            const Octave &oct = octaves[o];
+            __m128 freq = _mm_set1_ps(oct.frequency);
+            __m128 sx = _mm_mul_ps(px, freq);
+            __m128 sy = _mm_mul_ps(py, freq);
+            __m128 xf = floor4(sx);
+            __m128 yf = floor4(sy);
+            __m128 fx = _mm_sub_ps(sx, xf);
+            __m128 fy = _mm_sub_ps(sy, yf);
+
+            __m128i X0, X1, Y0, Y1;
+            lattice4(xf, oct.period, oct.offset, X0, X1);
+            lattice4(yf, oct.period, 0, Y0, Y1);
+
+            __m128i hA = gather4(perm, X0);
+            __m128i hB = gather4(perm, X1);
+            __m128i h00 = gather4(perm, _mm_add_epi32(hA, Y0));
+            __m128i h10 = gather4(perm, _mm_add_epi32(hB, Y0));
+            __m128i h01 = gather4(perm, _mm_add_epi32(hA, Y1));
+            __m128i h11 = gather4(perm, _mm_add_epi32(hB, Y1));
+
+            __m128 fx1 = _mm_sub_ps(fx, one);
+            __m128 fy1 = _mm_sub_ps(fy, one);
+            __m128 d00 = dot2(t, h00, fx, fy);
+            __m128 d10 = dot2(t, h10, fx1, fy);
+            __m128 d01 = dot2(t, h01, fx, fy1);
+            __m128 d11 = dot2(t, h11, fx1, fy1);
+
+            __m128 u = fade4(fx);
+            __m128 v = fade4(fy);
+            __m128 value = lerp4(lerp4(d00, d10, u), lerp4(d01, d11, u), v);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(oct.amplitude), value));
+        }
+        _mm_storeu_ps(out + i, sum);
+    }
+    fbm2Scalar(t, octaves, numOctaves, x, y, out, i, n);
+}
+
+void fbm3Sse2(const GradientTable &t, const Octave *octaves, int numOctaves,
+              const float *x, const float *y, const float *z, float *out, size_t n) {
+    const int32_t *perm = t.perm.data();
+    __m128 one = _mm_set1_ps(1);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        __m128 sum = _mm_setzero_ps();
+
+        for (int o = 0; o < numOctaves; o++) {
+            const Octave &oct = octaves[o];
+            __m128 freq = _mm_set1_ps(oct.frequency);
+            __m128 sx = _mm_mul_ps(px, freq);
+            __m128 sy = _mm_mul_ps(py, freq);
+            __m128 sz = _mm_mul_ps(pz, freq);
+            __m128 xf = floor4(sx);
+            __m128 yf = floor4(sy);
+            __m128 zf = floor4(sz);
+            __m128 fx = _mm_sub_ps(sx, xf);
+            __m128 fy = _mm_sub_ps(sy, yf);
+            __m128 fz = _mm_sub_ps(sz, zf);
+
+            __m128i X0, X1, Y0, Y1, Z0, Z1;
+            lattice4(xf, oct.period, oct.offset, X0, X1);
+            lattice4(yf, oct.period, 0, Y0, Y1);
+            lattice4(zf, oct.period, 0, Z0, Z1);
+
+            __m128i hA = gather4(perm, X0);
+            __m128i hB = gather4(perm, X1);
+            __m128i hAA = gather4(perm, _mm_add_epi32(hA, Y0));
+            __m128i hBA = gather4(perm, _mm_add_epi32(hB, Y0));
+            __m128i hAB = gather4(perm, _mm_add_epi32(hA, Y1));
+            __m128i hBB = gather4(perm, _mm_add_epi32(hB, Y1));
+
+            __m128 fx1 = _mm_sub_ps(fx, one);
+            __m128 fy1 = _mm_sub_ps(fy, one);
+            __m128 fz1 = _mm_sub_ps(fz, one);
+            __m128 d000 = dot3(t, gather4(perm, _mm_add_epi32(hAA, Z0)), fx,  fy,  fz);
+            __m128 d100 = dot3(t, gather4(perm, _mm_add_epi32(hBA, Z0)), fx1, fy,  fz);
+            __m128 d010 = dot3(t, gather4(perm, _mm_add_epi32(hAB, Z0)), fx,  fy1, fz);
+            __m128 d110 = dot3(t, gather4(perm, _mm_add_epi32(hBB, Z0)), fx1, fy1, fz);
+            __m128 d001 = dot3(t, gather4(perm, _mm_add_epi32(hAA, Z1)), fx,  fy,  fz1);
+            __m128 d101 = dot3(t, gather4(perm, _mm_add_epi32(hBA, Z1)), fx1, fy,  fz1);
+            __m128 d011 = dot3(t, gather4(perm, _mm_add_epi32(hAB, Z1)), fx,  fy1, fz1);
+            __m128 d111 = dot3(t, gather4(perm, _mm_add_epi32(hBB, Z1)), fx1, fy1, fz1);
+
+            __m128 u = fade4(fx);
+            __m128 v = fade4(fy);
+            __m128 w = fade4(fz);
+            __m128 value = lerp4(lerp4(lerp4(d000, d100, u), lerp4(d010, d110, u), v),
+                                 lerp4(lerp4(d001, d101, u), lerp4(d011, d111, u), v), w);
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(oct.amplitude), value));
+        }
+        _mm_storeu_ps(out + i, sum);
+    }
+    fbm3Scalar(t, octaves, numOctaves, x, y, z, out, i, n);
+}
+
+void fbm3GradSse2(const GradientTable &t, const Octave *octaves, int numOctaves,
+                  const float *x, const float *y, const float *z, float *out,
+                  float *dx, float *dy, float *dz, size_t n) {
+    const int32_t *perm = t.perm.data();
+    __m128 one = _mm_set1_ps(1);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+        __m128 sum = _mm_setzero_ps();
+        __m128 sumX = _mm_setzero_ps();
+        __m128 sumY = _mm_setzero_ps();
+        __m128 sumZ = _mm_setzero_ps();
+
+        for (int o = 0; o < numOctaves; o++) {
+            const Octave &oct = octaves[o];
+            __m128 freq = _mm_set1_ps(oct.frequency);
+            __m128 sx = _mm_mul_ps(px, freq);
+            __m128 sy = _mm_mul_ps(py, freq);
+            __m128 sz = _mm_mul_ps(pz, freq);
+            __m128 xf = floor4(sx);
+            __m128 yf = floor4(sy);
+            __m128 zf = floor4(sz);
+            __m128 fx = _mm_sub_ps(sx, xf);
+            __m128 fy = _mm_sub_ps(sy, yf);
+            __m128 fz = _mm_sub_ps(sz, zf);
+
+            __m128i X0, X1, Y0, Y1, Z0, Z1;
+            lattice4(xf, oct.period, oct.offset, X0, X1);
+            lattice4(yf, oct.period, 0, Y0, Y1);
+            lattice4(zf, oct.period, 0, Z0, Z1);
+
+            __m128i hA = gather4(perm, X0);
+            __m128i hB = gather4(perm, X1);
+            __m128i hAA = gather4(perm, _mm_add_epi32(hA, Y0));
+            __m128i hBA = gather4(perm, _mm_add_epi32(hB, Y0));
+            __m128i hAB = gather4(perm, _mm_add_epi32(hA, Y1));
+            __m128i hBB = gather4(perm, _mm_add_epi32(hB, Y1));
+            __m128i h[8] = {
+                gather4(perm, _mm_add_epi32(hAA, Z0)), gather4(perm, _mm_add_epi32(hBA, Z0)),
+                gather4(perm, _mm_add_epi32(hAB, Z0)), gather4(perm, _mm_add_epi32(hBB, Z0)),
+                gather4(perm, _mm_add_epi32(hAA, Z1)), gather4(perm, _mm_add_epi32(hBA, Z1)),
+                gather4(perm, _mm_add_epi32(hAB, Z1)), gather4(perm, _mm_add_epi32(hBB, Z1)),
+            };
+
+            __m128 fx1 = _mm_sub_ps(fx, one);
+            __m128 fy1 = _mm_sub_ps(fy, one);
+            __m128 fz1 = _mm_sub_ps(fz, one);
+            __m128 gx[8], gy[8], gz[8], d[8];
+            for (int c = 0; c < 8; c++) {
+                gx[c] = gather4(t.gx.data(), h[c]);
+                gy[c] = gather4(t.gy.data(), h[c]);
+                gz[c] = gather4(t.gz.data(), h[c]);
+                d[c] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(gx[c], c & 1 ? fx1 : fx),
+                                             _mm_mul_ps(gy[c], c & 2 ? fy1 : fy)),
+                                  _mm_mul_ps(gz[c], c & 4 ? fz1 : fz));
+            }
+
+            __m128 u = fade4(fx);
+            __m128 v = fade4(fy);
+            __m128 w = fade4(fz);
+            // As perlin3Grad
+            __m128 x0 = lerp4(lerp4(d[0], d[2], v), lerp4(d[4], d[6], v), w);
+            __m128 x1 = lerp4(lerp4(d[1], d[3], v), lerp4(d[5], d[7], v), w);
+            __m128 y0 = lerp4(lerp4(d[0], d[1], u), lerp4(d[4], d[5], u), w);
+            __m128 y1 = lerp4(lerp4(d[2], d[3], u), lerp4(d[6], d[7], u), w);
+            __m128 z0 = lerp4(lerp4(d[0], d[1], u), lerp4(d[2], d[3], u), v);
+            __m128 z1 = lerp4(lerp4(d[4], d[5], u), lerp4(d[6], d[7], u), v);
+            __m128 gradX = _mm_add_ps(trilerp4(gx, u, v, w),
+                                      _mm_mul_ps(fadeDerivative4(fx), _mm_sub_ps(x1, x0)));
+            __m128 gradY = _mm_add_ps(trilerp4(gy, u, v, w),
+                                      _mm_mul_ps(fadeDerivative4(fy), _mm_sub_ps(y1, y0)));
+            __m128 gradZ = _mm_add_ps(trilerp4(gz, u, v, w),
+                                      _mm_mul_ps(fadeDerivative4(fz), _mm_sub_ps(z1, z0)));
+
+            __m128 amp = _mm_set1_ps(oct.amplitude);
+            __m128 gradAmp = _mm_set1_ps(oct.amplitude * oct.frequency);
+            sum = _mm_add_ps(sum, _mm_mul_ps(amp, lerp4(z0, z1, w)));
+            sumX = _mm_add_ps(sumX, _mm_mul_ps(gradAmp, gradX));
+            sumY = _mm_add_ps(sumY, _mm_mul_ps(gradAmp, gradY));
+            sumZ = _mm_add_ps(sumZ, _mm_mul_ps(gradAmp, gradZ));
+        }
+        _mm_storeu_ps(out + i, sum);
+        _mm_storeu_ps(dx + i, sumX);
+        _mm_storeu_ps(dy + i, sumY);
+        _mm_storeu_ps(dz + i, sumZ);
+    }
+    fbm3GradScalar(t, octaves, numOctaves, x, y, z, out, dx, dy, dz, i, n);
+}
+
+}
+
+#endif
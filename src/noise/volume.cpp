@@ -0,0 +1,93 @@
+#include "volume.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace noise {
+
+void forEachTile(int resolution,
+                 const std::function<void(glm::ivec3, glm::ivec3)> &fn) {
+    forEachTile(resolution, 0, resolution, fn);
+}
+
+void forEachTile(int resolution, int zBegin, int zEnd,
+                 const std::function<void(glm::ivec3, glm::ivec3)> &fn) {
+    int tilesPerSide = (resolution + tileSize - 1) / tileSize;
+    int firstLayer = zBegin / tileSize;
+    int numLayers = (zEnd + tileSize - 1) / tileSize - firstLayer;
+    int numTiles = tilesPerSide * tilesPerSide * glm::max(numLayers, 0);
+
+    std::atomic<int> nextTile = 0;
+    auto work = [&] {
+        for (int tile = nextTile++; tile < numTiles; tile = nextTile++) {
+            glm::ivec3 index(tile % tilesPerSide,
+                             tile / tilesPerSide % tilesPerSide,
+                             firstLayer + tile / (tilesPerSide * tilesPerSide));
+            glm::ivec3 tileMin = index * tileSize;
+            glm::ivec3 tileMax = glm::min(tileMin + tileSize, glm::ivec3(resolution));
+            tileMin.z = glm::max(tileMin.z, zBegin);
+            tileMax.z = glm::min(tileMax.z, zEnd);
+            fn(tileMin, tileMax);
+        }
+    };
+
+    // The calling thread works too, so a single tile needs no extra threads
+    int numThreads = std::min<int>(std::thread::hardware_concurrency(), numTiles);
+    std::vector<std::jthread> helpers;
+    for (int i = 1; i < numThreads; i++) {
+        helpers.emplace_back(work);
+    }
+    work();
+}
+
+void fbm3Tile(const GradientTable &table, const Fbm &fbm, int resolution,
+              glm::ivec3 tileMin, glm::ivec3 tileMax, float *out) {
+    int width = tileMax.x - tileMin.x;
+    float xs[tileSize], ys[tileSize], zs[tileSize];
+    for (int x = 0; x < width; x++) {
+        xs[x] = (tileMin.x + x + 0.5f) / resolution;
+    }
+    for (int z = tileMin.z; z < tileMax.z; z++) {
+        std::fill(zs, zs + width, (z + 0.5f) / resolution);
+        for (int y = tileMin.y; y < tileMax.y; y++) {
+            std::fill(ys, ys + width, (y + 0.5f) / resolution);
+            fbm3(table, fbm, xs, ys, zs,
+                 &out[(z * resolution + y) * resolution + tileMin.x], width);
+        }
+    }
+}
+
+void fbm3GradTile(const GradientTable &table, const Fbm &fbm, int resolution,
+                  glm::ivec3 tileMin, glm::ivec3 tileMax, float *out) {
+    int width = tileMax.x - tileMin.x;
+    float xs[tileSize], ys[tileSize], zs[tileSize];
+    float value[tileSize], dx[tileSize], dy[tileSize], dz[tileSize];
+    for (int x = 0; x < width; x++) {
+        xs[x] = (tileMin.x + x + 0.5f) / resolution;
+    }
+    for (int z = tileMin.z; z < tileMax.z; z++) {
+        std::fill(zs, zs + width, (z + 0.5f) / resolution);
+        for (int y = tileMin.y; y < tileMax.y; y++) {
+            std::fill(ys, ys + width, (y + 0.5f) / resolution);
+            fbm3Grad(table, fbm, xs, ys, zs, value, dx, dy, dz, width);
+            float *row = &out[4 * ((z * resolution + y) * resolution + tileMin.x)];
+            for (int x = 0; x < width; x++) {
+                row[4 * x] = dx[x];
+                row[4 * x + 1] = dy[x];
+                row[4 * x + 2] = dz[x];
+                row[4 * x + 3] = value[x];
+            }
+        }
+    }
+}
+
+void fbm3Volume(const GradientTable &table, const Fbm &fbm, int resolution,
+                float *out) {
+    forEachTile(resolution, [&](glm::ivec3 tileMin, glm::ivec3 tileMax) {
+        fbm3Tile(table, fbm, resolution, tileMin, tileMax, out);
+    });
+}
+
+}
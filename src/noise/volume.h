@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "perlin.h"
+
+// Generation of noise volumes, one cubic tile at a time so that each tile's
+// working set stays in cache, with tiles spread across worker threads.
+//
+// Volumes are resolution^3 grids of texel centres spanning the unit cube,
+// stored x-fastest: voxel (x, y, z) is at index (z * resolution + y) * resolution + x.
+namespace noise {
+
+// Edge length of a tile, in voxels. Rows of a tile are two AVX2 batches.
+constexpr int tileSize = 16;
+
+// Calls fn(tileMin, tileMax) for every tile of a resolution^3 volume, where
+// the tile spans [tileMin, tileMax). Tiles are handed out to a pool of
+// worker threads and may run in any order; they never overlap, so fn can
+// write its own voxels without locking. Returns once all tiles are done.
+void forEachTile(int resolution,
+                 const std::function<void(glm::ivec3, glm::ivec3)> &fn);
+
+// As above, for the tiles of the slab of layers [zBegin, zEnd) only. Tiles
+// are clipped to the slab, so slabs should start and end on multiples of
+// tileSize to keep them whole.
+void forEachTile(int resolution, int zBegin, int zEnd,
+                 const std::function<void(glm::ivec3, glm::ivec3)> &fn);
+
+// Samples fbm at the voxels [tileMin, tileMax) of a resolution^3 volume
+void fbm3Tile(const GradientTable &table, const Fbm &fbm, int resolution,
+              glm::ivec3 tileMin, glm::ivec3 tileMax, float *out);
+
+// As fbm3Tile, with four floats per voxel: fbm's gradient (x, y, z), then
+// its value
+void fbm3GradTile(const GradientTable &table, const Fbm &fbm, int resolution,
+                  glm::ivec3 tileMin, glm::ivec3 tileMax, float *out);
+
+// Samples fbm at every voxel of a resolution^3 volume. Each voxel depends
+// only on its coordinates, so the result is the same however the tiles
+// are scheduled.
+void fbm3Volume(const GradientTable &table, const Fbm &fbm, int resolution,
+                float *out);
+
+}
@@ -53,6 +53,9 @@ void Realtime::finish() {
     glDeleteProgram(m_fbo_shader);
     glDeleteVertexArrays(1, &m_fullscreen_vao);
     glDeleteBuffers(1, &m_fullscreen_vbo);
+    // freeing terrain chunks and the tessellated terrain
+    m_terrain.clear();
+    m_terrainTess.finish();
     // freeing skybox-related materials
     glDeleteProgram(m_skybox_shader);
     glDeleteVertexArrays(1, &m_skybox_vao);
@@ -134,9 +137,18 @@ void Realtime::initializeGL() {
     //reset
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
+
     makeFBO();
 
+    m_terrainTess.initialize();
+
     cloud::initializeClouds();
+    cloud::setResolutionDivisor(settings.cloudResolutionDivisor);
+    cloud::setTemporalAccumulation(settings.cloudTemporal);
+    cloud::setSliceOrder(settings.cloudFrontToBack ? cloud::SliceOrder::FrontToBack
+                                                   : cloud::SliceOrder::BackToFront);
+    cloud::setPrecomputedLighting(settings.cloudLightVolume);
+    cloud::setNoiseResolution(settings.cloudNoiseResolution);
 }
 
 /**
@@ -205,8 +217,10 @@ void Realtime::paintGL() {
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
     glUseProgram(0);
 
-    glUseProgram(m_shader); // Bind the shader //////////////////////////////////////////////////////////////////////////
-    glBindVertexArray(m_terrain_vao);
+    // the tessellated terrain shades with the same uniforms as m_shader
+    GLuint terrainShader = settings.terrainTessellation ? m_terrainTess.program()
+                                                        : m_shader;
+    glUseProgram(terrainShader); // Bind the shader //////////////////////////////////////////////////////////////////////////
 
     // hard-coded
     glm::vec4 cAmbient = glm::vec4(0.3f);
@@ -214,10 +228,10 @@ void Realtime::paintGL() {
     glm::vec4 cSpecular = glm::vec4(0.0f);
     float shininess = 1.0;
 
-    glUniform4fv(glGetUniformLocation(m_shader, "cAmbient"), 1, &cAmbient[0]);
-    glUniform4fv(glGetUniformLocation(m_shader, "cDiffuse"), 1, &cDiffuse[0]);
-    glUniform4fv(glGetUniformLocation(m_shader, "cSpecular"), 1, &cSpecular[0]);
-    glUniform1f(glGetUniformLocation(m_shader, "sh"), shininess);
+    glUniform4fv(glGetUniformLocation(terrainShader, "cAmbient"), 1, &cAmbient[0]);
+    glUniform4fv(glGetUniformLocation(terrainShader, "cDiffuse"), 1, &cDiffuse[0]);
+    glUniform4fv(glGetUniformLocation(terrainShader, "cSpecular"), 1, &cSpecular[0]);
+    glUniform1f(glGetUniformLocation(terrainShader, "sh"), shininess);
 
     int numLights = renderData.lights.size();
     std::string str;
@@ -228,69 +242,73 @@ void Realtime::paintGL() {
         switch (light.type) {
         case LightType::LIGHT_DIRECTIONAL:
             str = "lights[" + std::to_string(j) + "]";
-            loc = glGetUniformLocation(m_shader, str.c_str());
+            loc = glGetUniformLocation(terrainShader, str.c_str());
             glUniform4f(loc, 1, light.dir[0], light.dir[1], light.dir[2]);
             break;
         case LightType::LIGHT_POINT:
             str = "lights[" + std::to_string(j) + "]";
-            loc = glGetUniformLocation(m_shader, str.c_str());
+            loc = glGetUniformLocation(terrainShader, str.c_str());
             glUniform4f(loc, 0, light.pos[0], light.pos[1], light.pos[2]);
             break;
 
         case LightType::LIGHT_SPOT:
             str = "lights[" + std::to_string(j) + "]";
-            loc = glGetUniformLocation(m_shader, str.c_str());
+            loc = glGetUniformLocation(terrainShader, str.c_str());
             glUniform4f(loc, 2, light.pos[0], light.pos[1], light.pos[2]);
 
             str = "spotDir[" + std::to_string(j) + "]";
-            loc = glGetUniformLocation(m_shader, str.c_str());
+            loc = glGetUniformLocation(terrainShader, str.c_str());
             glUniform3f(loc, light.dir[0], light.dir[1], light.dir[2]);
 
             // uniform variables for angles to calculate angular fall off
-            glUniform1f(glGetUniformLocation(m_shader, "thetaO"), light.angle);
-            glUniform1f(glGetUniformLocation(m_shader, "thetaI"),
+            glUniform1f(glGetUniformLocation(terrainShader, "thetaO"), light.angle);
+            glUniform1f(glGetUniformLocation(terrainShader, "thetaI"),
                         (light.angle - light.penumbra));
             break;
         default:
             break;
         }
         str = "att[" + std::to_string(j) + "]";
-        loc = glGetUniformLocation(m_shader, str.c_str());
+        loc = glGetUniformLocation(terrainShader, str.c_str());
         glUniform3f(loc, light.function[0], light.function[1], light.function[2]);
 
         str = "colors[" + std::to_string(j) + "]";
-        loc = glGetUniformLocation(m_shader, str.c_str());
+        loc = glGetUniformLocation(terrainShader, str.c_str());
         glUniform4f(loc, 1, renderData.lights[j].color[0],
                 renderData.lights[j].color[1],
                 renderData.lights[j].color[2]);
     }
-    glUniform1i(glGetUniformLocation(m_shader, "numLights"), j);
+    glUniform1i(glGetUniformLocation(terrainShader, "numLights"), j);
 
     glm::mat4 placeholderCTM = glm::mat4(1);
 
-    glUniformMatrix4fv(glGetUniformLocation(m_shader, "ctm"),
+    glUniformMatrix4fv(glGetUniformLocation(terrainShader, "ctm"),
                        1, GL_FALSE, &placeholderCTM[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_shader, "n_ctm"),
+    glUniformMatrix4fv(glGetUniformLocation(terrainShader, "n_ctm"),
                        1, GL_FALSE, &placeholderCTM[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_shader, "viewMat"),
+    glUniformMatrix4fv(glGetUniformLocation(terrainShader, "viewMat"),
                        1, GL_FALSE, &m_view[0][0]);
-    glUniformMatrix4fv(glGetUniformLocation(m_shader, "projMat"),
+    glUniformMatrix4fv(glGetUniformLocation(terrainShader, "projMat"),
                        1, GL_FALSE, &m_proj[0][0]);
 
-    glUniform1f(glGetUniformLocation(m_shader, "ka"), m_ka);
-    glUniform1f(glGetUniformLocation(m_shader, "kd"), m_kd);
-    glUniform1f(glGetUniformLocation(m_shader, "ks"), m_ks);
+    glUniform1f(glGetUniformLocation(terrainShader, "ka"), m_ka);
+    glUniform1f(glGetUniformLocation(terrainShader, "kd"), m_kd);
+    glUniform1f(glGetUniformLocation(terrainShader, "ks"), m_ks);
 
-    glUniform1i(glGetUniformLocation(m_shader, "fogType"), settings.fogType);
+    glUniform1i(glGetUniformLocation(terrainShader, "fogType"), settings.fogType);
     float testFogVal = settings.fogValue;
-    glUniform1f(glGetUniformLocation(m_shader, "fogIntensity"), (settings.fogValue)/100);
+    glUniform1f(glGetUniformLocation(terrainShader, "fogIntensity"), (settings.fogValue)/100);
 
     glm::vec4 origin{0.0f,0.0f,0.0f, 1.0f};
     glm::vec4 camP = glm::inverse(m_view) * origin;
-    glUniform4fv(glGetUniformLocation(m_shader, "camPos"), 1, &camP[0]);
+    glUniform4fv(glGetUniformLocation(terrainShader, "camPos"), 1, &camP[0]);
 
-    glDrawArrays(GL_TRIANGLES, 0, m_terrainVertexData.size() / 6);
-    glBindVertexArray(0);
+    if (settings.terrainTessellation) {
+        float lodScale = 0.5f * m_fbo_height / glm::tan(0.5f * camera.heightAngle);
+        m_terrainTess.draw(lodScale);
+    } else {
+        m_terrain.draw(m_proj * m_view);
+    }
     // Unbind the shader
     glUseProgram(0);
 
@@ -365,6 +383,13 @@ void Realtime::sceneChanged() {
     m_ks = renderData.globalData.ks;
     updateVBO();
     cloud::setCamera(camera);
+    // Clouds are shadowed from the first directional light
+    for (const SceneLightData &light : renderData.lights) {
+        if (light.type == LightType::LIGHT_DIRECTIONAL) {
+            cloud::setLightDirection(glm::vec3(light.dir));
+            break;
+        }
+    }
     update(); // asks for a PaintGL() call to occur
 }
 
@@ -386,56 +411,33 @@ void Realtime::settingsChanged() {
 
     cloud::setFarPlane(settings.farPlane);
     cloud::setCamera(camera);
+    cloud::setRenderMode(static_cast<cloud::RenderMode>(settings.cloudRenderMode));
+    cloud::setResolutionDivisor(settings.cloudResolutionDivisor);
+    cloud::setTemporalAccumulation(settings.cloudTemporal);
+    cloud::setSliceOrder(settings.cloudFrontToBack ? cloud::SliceOrder::FrontToBack
+                                                   : cloud::SliceOrder::BackToFront);
+    cloud::setPrecomputedLighting(settings.cloudLightVolume);
+    cloud::setNoiseResolution(settings.cloudNoiseResolution);
     update();
 }
 
 /**
- * @brief Realtime::updateVBO - Highly important function that handles
- * the most important task: making just the right number of VBOs For more info,
- * please read the README. The jist is that I never prepare more than 4 VBO/VAO
- * pairs, (1) for each unit primitive.
- * Since the function is hefty: here's step by step
- * 1. For each shape, check its type.
- * 2. Using shapeCheck<>, check if the given shape is the first of its kind
- *    to come through the loop. If so, store th pointer of the shape in the
- *    primitive shape class (Cube, Cylinder, etc.). Also, prepare vertex data
- *    using methods in the primitive's shape class. O/W get the true
- *    first of a shape to come through (stored in primitive shape's class)
- * 3.  If the current shape is the first of its kind, allocate/bind, & arrange
- *     memory for the VBO and the VAO for a shape.
- * 4. Otherwise, using the stored pointer to the first shape to come through
- *    Find the first shape's vbo/vao and copy it.
+ * @brief Realtime::updateVBO - keeps the terrain chunks around the camera
+ * up to date. Missing chunks, or chunks built with an old tesselation
+ * parameter, are generated on a worker thread; until they are ready, whatever
+ * is already resident keeps being drawn. In tessellation mode, this instead
+ * uploads the baked heightmap once it is ready.
  */
 void Realtime::updateVBO() {
-    makeCurrent(); // allows GL context to be updated here
-    // tracks which shapes have had their "first" of their kind come through
     if (!glIni) {
         return;
     }
-
-    glGenBuffers(1, &m_terrain_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_terrain_vbo);
-
-    m_terrainVertexData = terrain.updateParams(settings.shapeParameter1);
-    glBufferData(GL_ARRAY_BUFFER, (sizeof(GLfloat) *
-                                   m_terrainVertexData.size()),
-                 (m_terrainVertexData.data()), GL_STATIC_DRAW);
-
-    // Vertex Array Objects
-    glGenVertexArrays(1, &m_terrain_vao);
-    glBindVertexArray(m_terrain_vao);
-
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-
-    // two sets of three floats, vertices, norms
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 24,
-                          reinterpret_cast<void*>(0));
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 24,
-                          reinterpret_cast<void*>((3 * sizeof(GLfloat))));
-    // Returning to Default State
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+    makeCurrent(); // allows GL context to be updated here
+    if (settings.terrainTessellation) {
+        m_terrainTess.update();
+    } else {
+        m_terrain.update(camera.pos, settings.farPlane, settings.shapeParameter1);
+    }
 }
 
 // updates m_keyMap according to key presses
@@ -556,5 +558,11 @@ void Realtime::timerEvent(QTimerEvent *event) {
     m_view = camera.getViewMatrix();
     m_proj = camera.getPerspectiveMatrix();
     cloud::setCamera(camera);
+    if (settings.cloudAnimation) {
+        cloud::advanceTime(deltaTime);
+    }
+
+    // stream terrain chunks in and out as the camera moves
+    updateVBO();
     update(); // asks for a PaintGL() call to occur
 }
@@ -2,7 +2,8 @@
 
 // Defined before including GLEW to suppress deprecation messages on macOS
 #include "camera.h"
-#include "shapes/Terrain.h"
+#include "shapes/terrainchunks.h"
+#include "shapes/terraintessellation.h"
 #include "shapes/cube.h"
 #include "shapes/cylinder.h"
 #include "shapes/sphere.h"
@@ -64,10 +65,8 @@ private:
     Cube cube;
     Cylinder cylinder;
     Cone cone;
-    Terrain terrain;
-    GLuint m_terrain_vbo;
-    GLuint m_terrain_vao;
-    std::vector<float> m_terrainVertexData;
+    TerrainChunks m_terrain; // streamed terrain chunks around the camera
+    TerrainTessellation m_terrainTess; // GPU-tessellated terrain mode
 
     // globals I'm using for openGL
     GLuint m_shader;     // Stores id of shader program
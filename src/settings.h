@@ -13,6 +13,14 @@ struct Settings {
     bool perPixelFilter = false;
     bool kernelBasedFilter = false;
     bool cloudsToggle = false;
+    int cloudRenderMode = 0; // a cloud::RenderMode
+    bool cloudTemporal = false;
+    bool cloudFrontToBack = false;
+    bool cloudLightVolume = false;
+    bool cloudAnimation = false;
+    int cloudResolutionDivisor = 2;
+    int cloudNoiseResolution = 64;
+    bool terrainTessellation = false;
     bool extraCredit1 = false;
     bool extraCredit2 = false;
     bool extraCredit3 = false;
@@ -1,156 +1,147 @@
 #include "Terrain.h"
 
-std::vector<float> Terrain::updateParams(int param1) {
-    m_vertexData = std::vector<float>();
-    m_param1 = param1;
-    m_lookupSize = 1024;
-    m_randVecLookup.reserve(m_lookupSize);
-
-    // Initialize random number generator
-    std::srand(1230);
-
-    // Populate random vector lookup table
-    for (int i = 0; i < m_lookupSize; i++)
-    {
-      m_randVecLookup.push_back(glm::vec2(std::rand() * 2.0 / RAND_MAX - 1.0,
-                                          std::rand() * 2.0 / RAND_MAX - 1.0));
-    }
+#include <algorithm>
 
-    makeFace();
-    return m_vertexData;
+Terrain::Terrain()
+    : m_gradients(noise::GradientTable::make2D(1230))
+{
 }
 
-// ====================================== PERLIN HELPERS ====================================== //
+TerrainMesh Terrain::generateChunk(int param1, glm::ivec2 chunk,
+                                   std::stop_token stop) {
+    m_mesh = TerrainMesh();
+    m_param1 = param1;
+    m_chunk = chunk;
+    m_stop = stop;
 
-// Helper for computePerlin() and, possibly, getColor()
-float Terrain::interpolate(float A, float B, float alpha) {
-    float ease = 3 * pow(alpha, 2) - 2 * pow(alpha, 3);
-    return A + ease * (B - A);
+    makeFace();
+    return std::move(m_mesh);
 }
 
-// Samples the (infinite) random vector grid at (row, col)
-glm::vec2 Terrain::sampleRandomVector(int row, int col) {
-    std::hash<int> intHash;
-    int index = intHash(row * 41 + col * 43) % m_lookupSize;
-    return m_randVecLookup.at(index);
+std::vector<float> Terrain::bakeHeightmap(glm::vec2 origin, float size,
+                                          int resolution) {
+    std::vector<float> heights(resolution * resolution);
+    std::vector<float> xs(resolution), ys(resolution);
+    float step = size / (resolution - 1);
+    for (int x = 0; x < resolution; x++) {
+        xs[x] = (origin.x + x * step + chunkSize / 2.0f) / chunkSize;
+    }
+    for (int z = 0; z < resolution; z++) {
+        std::fill(ys.begin(), ys.end(),
+                  (origin.y + z * step + chunkSize / 2.0f) / chunkSize);
+        getHeights(xs.data(), ys.data(), &heights[z * resolution], resolution);
+    }
+    for (float &h : heights) {
+        h *= chunkSize;
+    }
+    return heights;
 }
 
-// Computes the intensity of Perlin noise at some point
-float Terrain::computePerlin(float x, float y) {
-    // Get grid indices (as ints)
-    int X = (int)x;
-    int Y = (int)y;
-    glm::vec2 i1 = {X, Y};
-    glm::vec2 i2 = {X + 1, Y};
-    glm::vec2 i3 = {X, Y + 1};
-    glm::vec2 i4 = {X + 1, Y + 1};
-
-    // Compute offset vectors
-    glm::vec2 input = {x,y};
-    glm::vec2 off1 = input - i1;
-    glm::vec2 off2 = input - i2;
-    glm::vec2 off3 = input - i3;
-    glm::vec2 off4 = input - i4;
-
-    // Compute the dot product between offset and grid vectors
-    float dot1 = glm::dot(off1, sampleRandomVector(i1[0], i1[1]));
-    float dot2 = glm::dot(off2, sampleRandomVector(i2[0], i2[1]));
-    float dot3 = glm::dot(off3, sampleRandomVector(i3[0], i3[1]));
-    float dot4 = glm::dot(off4, sampleRandomVector(i4[0], i4[1]));
-
-    // Use your interpolation function to produce the final value
-    float inter1 = interpolate(dot1, dot2, x - i1[0]);
-    float inter2 = interpolate(dot3, dot4, x - i1[0]);
-
-    // Return 0 as a placeholder
-    return interpolate(inter1, inter2, y - i1[1]);
+glm::ivec2 Terrain::chunkAt(float x, float z) {
+    return glm::ivec2(glm::floor((x + chunkSize / 2.0f) / chunkSize),
+                      glm::floor((z + chunkSize / 2.0f) / chunkSize));
 }
 
-// Takes a normalized (x, y) position, in range [0,1)
-// Returns a height value, z, by sampling a noise function
-float Terrain::getHeight(float x, float y) {
-
-    float z = 0;
-
-    // Combine multiple different octaves of noise to produce fractal perlin noise
-    z += computePerlin(x * 8, y * 8) / 8;
-    z += computePerlin(x * 16, y * 16) / 16;
-    z += computePerlin(x * 32, y * 32) / 32;
-    z += computePerlin(x * 64, y * 64) / 64;
+// ====================================== PERLIN HELPERS ====================================== //
 
-    return z;
+// Takes normalized (x, y) positions, where each unit is one chunk
+// Writes a height value for each by sampling a noise function
+void Terrain::getHeights(const float *x, const float *y, float *out, size_t n) {
+    // Combine multiple different octaves of noise to produce fractal perlin
+    // noise: 8, 16, 32 and 64 cells per chunk, each weighted by 1 / cells
+    noise::Fbm fbm;
+    fbm.octaves = 4;
+    fbm.frequency = 8;
+    fbm.amplitude = 1.0f / 8;
+    noise::fbm2(m_gradients, fbm, x, y, out, n);
 }
 
 // ====================================== BASE PLANE ====================================== //
 
-void Terrain::makeTile(glm::vec3 topLeft,
-                    glm::vec3 topRight,
-                    glm::vec3 bottomLeft,
-                    glm::vec3 bottomRight) {
-
-    //normals are destination - source
-    glm::vec3 TLnormal = glm::normalize(glm::cross(bottomLeft - topLeft, topRight - topLeft));
-    glm::vec3 TRnormal = glm::normalize(glm::cross(topLeft - topRight, bottomRight - topRight));
-    glm::vec3 BLnormal = glm::normalize(glm::cross(bottomRight - bottomLeft, topLeft - bottomLeft));
-    glm::vec3 BRnormal = glm::normalize(glm::cross(topRight - bottomRight, bottomLeft - bottomRight));
-
-    // triangle 1
-    insertVec3(m_vertexData, topLeft);
-    insertVec3(m_vertexData, TLnormal);
-    insertVec3(m_vertexData, bottomLeft);
-    insertVec3(m_vertexData, BLnormal);
-    insertVec3(m_vertexData, bottomRight);
-    insertVec3(m_vertexData, BRnormal);
-
-    // triangle 2
-    insertVec3(m_vertexData, topLeft);
-    insertVec3(m_vertexData, TLnormal);
-    insertVec3(m_vertexData, bottomRight);
-    insertVec3(m_vertexData, BRnormal);
-    insertVec3(m_vertexData, topRight);
-    insertVec3(m_vertexData, TRnormal);
-}
-
+// Builds chunk m_chunk as an indexed grid. Every grid point is sampled once and
+// shared by the (up to) six triangles around it, and its normal is taken from
+// central differences of the neighbouring heights.
 void Terrain::makeFace() {
 
-    glm::vec3 topLeft, topRight, bottomLeft, bottomRight;
-
     float m_resolution = 5.0;
-    float m_terrainSize = 50.0;
+    float m_terrainSize = chunkSize;
     float m_halfRes = m_terrainSize / 2.0;
     float m_heightMultiplier = m_terrainSize; // terrain size gives best default results, but this can be modified as desired
 
-    float xVal, xValLong;
-    float yVal, yValLong;
-    float zVal;
-
-
-    float sideLength = m_terrainSize / (m_param1 * m_resolution);
-    for (int x = 0; x < (m_param1 * m_resolution); x ++) {
-        xVal = -m_halfRes + (x * sideLength);
-        xValLong = xVal + sideLength;
-
-        for (int y = 0; y < (m_param1 * m_resolution); y ++) {
-            yVal = -m_halfRes + (y * sideLength);
-            yValLong = yVal + sideLength;
-
-            zVal = m_heightMultiplier * getHeight((xVal + m_halfRes) / m_terrainSize, (yValLong + m_halfRes) / m_terrainSize);
-            topLeft = {xVal, zVal, yValLong};
-
-            zVal = m_heightMultiplier * getHeight((xValLong + m_halfRes) / m_terrainSize, (yValLong + m_halfRes) / m_terrainSize);
-            topRight = {xValLong, zVal, yValLong};
-
-            zVal = m_heightMultiplier * getHeight((xVal + m_halfRes) / m_terrainSize, (yVal + m_halfRes) / m_terrainSize);
-            bottomLeft = {xVal, zVal, yVal};
-
-            zVal = m_heightMultiplier * getHeight((xValLong + m_halfRes) / m_terrainSize, (yVal + m_halfRes) / m_terrainSize);
-            bottomRight = {xValLong, zVal, yVal};
-
+    int numTiles = m_param1 * m_resolution;
+    int numVerts = numTiles + 1;
+    float sideLength = m_terrainSize / numTiles;
+
+    // Heights are sampled with a one-point border so that edge vertices
+    // also get central-difference normals, which then match the neighbouring
+    // chunks exactly.
+    int stride = numVerts + 2;
+    std::vector<float> heights(stride * stride);
+    std::vector<float> xNorm(stride), yNorm(stride);
+    for (int x = 0; x < stride; x++) {
+        xNorm[x] = m_chunk.x + (x - 1) / (float)numTiles;
+    }
+    for (int y = 0; y < stride; y++) {
+        if (m_stop.stop_requested()) {
+            return;
+        }
+        std::fill(yNorm.begin(), yNorm.end(), m_chunk.y + (y - 1) / (float)numTiles);
+        getHeights(xNorm.data(), yNorm.data(), &heights[y * stride], stride);
+    }
+    for (float &h : heights) {
+        h *= m_heightMultiplier;
+    }
 
-            makeTile(topRight, topLeft, bottomRight, bottomLeft);
+    glm::vec2 origin = glm::vec2(m_chunk) * m_terrainSize - m_halfRes;
+    float firstHeight = heights[stride + 1];
+    m_mesh.boundsMin = glm::vec3(origin.x, firstHeight, origin.y);
+    m_mesh.boundsMax = glm::vec3(origin.x + m_terrainSize, firstHeight,
+                                 origin.y + m_terrainSize);
+
+    m_mesh.vertexData.reserve(numVerts * numVerts * 6);
+    for (int y = 0; y < numVerts; y++) {
+        float yVal = origin.y + (y * sideLength);
+
+        for (int x = 0; x < numVerts; x++) {
+            float xVal = origin.x + (x * sideLength);
+
+            const float *h = &heights[(y + 1) * stride + (x + 1)];
+            float hLeft = h[-1];
+            float hRight = h[1];
+            float hDown = h[-stride];
+            float hUp = h[stride];
+
+            glm::vec3 position = {xVal, h[0], yVal};
+            glm::vec3 normal = glm::normalize(glm::vec3(hLeft - hRight,
+                                                        2.0f * sideLength,
+                                                        hDown - hUp));
+            insertVec3(m_mesh.vertexData, position);
+            insertVec3(m_mesh.vertexData, normal);
+
+            m_mesh.boundsMin.y = glm::min(m_mesh.boundsMin.y, h[0]);
+            m_mesh.boundsMax.y = glm::max(m_mesh.boundsMax.y, h[0]);
         }
     }
 
+    m_mesh.indices.reserve(numTiles * numTiles * 6);
+    for (int y = 0; y < numTiles; y++) {
+        for (int x = 0; x < numTiles; x++) {
+            uint32_t bottomLeft = y * numVerts + x;
+            uint32_t bottomRight = bottomLeft + 1;
+            uint32_t topLeft = bottomLeft + numVerts;
+            uint32_t topRight = topLeft + 1;
+
+            // triangle 1
+            m_mesh.indices.push_back(topRight);
+            m_mesh.indices.push_back(bottomRight);
+            m_mesh.indices.push_back(bottomLeft);
+
+            // triangle 2
+            m_mesh.indices.push_back(topRight);
+            m_mesh.indices.push_back(bottomLeft);
+            m_mesh.indices.push_back(topLeft);
+        }
+    }
 }
 
 // Inserts a glm::vec3 into a vector of floats.
@@ -1,33 +1,56 @@
 #pragma once
 
+#include <cstdint>
+#include <stop_token>
 #include <vector>
 #include <glm/glm.hpp>
 
+#include "noise/perlin.h"
+
+// Indexed terrain mesh: each grid point appears once in vertexData as an
+// interleaved (position, normal) pair, and indices lists its triangles.
+// boundsMin/boundsMax are the world-space AABB of the vertices.
+struct TerrainMesh {
+    std::vector<float> vertexData;
+    std::vector<uint32_t> indices;
+    glm::vec3 boundsMin = glm::vec3(0);
+    glm::vec3 boundsMax = glm::vec3(0);
+};
+
+// The terrain is an unbounded heightfield split into square chunks.
+// Chunk (0, 0) spans [-chunkSize / 2, chunkSize / 2] in x and z.
 class Terrain
 {
 public:
-    std::vector<float> updateParams(int param1);
-//    std::vector<float> generateShape() { return m_vertexData; }
+    static constexpr float chunkSize = 50.0;
 
+    Terrain();
 
-private:
-    std::vector<float> m_vertexData;
-    std::vector<glm::vec2> m_randVecLookup;
+    // Generates the mesh of one chunk for the given tesselation parameter.
+    // If stop is triggered part-way through, the returned mesh is incomplete
+    // and should be discarded.
+    TerrainMesh generateChunk(int param1, glm::ivec2 chunk,
+                              std::stop_token stop = {});
 
-    glm::vec2 sampleRandomVector(int row, int col);
+    // Samples the heightfield on a resolution x resolution grid spanning the
+    // square [origin, origin + size] in the xz-plane. Row-major, z rows.
+    std::vector<float> bakeHeightmap(glm::vec2 origin, float size, int resolution);
+
+    // Returns the chunk containing the world-space point (x, _, z)
+    static glm::ivec2 chunkAt(float x, float z);
+
+
+private:
+    TerrainMesh m_mesh;
+    noise::GradientTable m_gradients;
 
-    int m_lookupSize;
     int m_param1;
+    glm::ivec2 m_chunk;
+    std::stop_token m_stop;
 
-    float computePerlin(float x, float y);
-    float getHeight(float x, float y);
-    float interpolate(float A, float B, float alpha);
+    void getHeights(const float *x, const float *y, float *out, size_t n);
 
     void insertVec3(std::vector<float> &data, glm::vec3 v);
-    void makeTile(glm::vec3 topLeft,
-                  glm::vec3 topRight,
-                  glm::vec3 bottomLeft,
-                  glm::vec3 bottomRight);
     void makeFace();
 
 };
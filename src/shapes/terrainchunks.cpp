@@ -0,0 +1,162 @@
+#include "terrainchunks.h"
+
+#include <algorithm>
+
+// Distance in the xz-plane from p to the square footprint of a chunk
+static float chunkDistance(glm::vec2 p, glm::ivec2 chunk) {
+    glm::vec2 lo = glm::vec2(chunk) * Terrain::chunkSize - Terrain::chunkSize / 2.0f;
+    glm::vec2 hi = lo + Terrain::chunkSize;
+    return glm::length(glm::max(glm::max(lo - p, p - hi), glm::vec2(0)));
+}
+
+// Tests an AABB against the six frustum planes of viewProj
+// (Gribb & Hartmann plane extraction).
+static bool inFrustum(const glm::mat4 &viewProj, glm::vec3 lo, glm::vec3 hi) {
+    glm::mat4 rows = glm::transpose(viewProj);
+    for (int i = 0; i < 6; i++) {
+        glm::vec4 plane = rows[3] + ((i % 2 == 0) ? 1.0f : -1.0f) * rows[i / 2];
+        // Corner of the box furthest along the plane normal
+        glm::vec3 p = glm::mix(lo, hi, glm::step(glm::vec3(0), glm::vec3(plane)));
+        if (glm::dot(glm::vec3(plane), p) + plane.w < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief TerrainChunks::update
+ * @param cameraPos - world-space camera position
+ * @param viewDistance - chunks whose footprint is within this distance are wanted
+ * @param param1 - tesselation parameter
+ */
+void TerrainChunks::update(glm::vec3 cameraPos, float viewDistance, int param1) {
+    m_worker.takeResults(m_results);
+    for (TerrainChunkResult &result : m_results) {
+        upload(result);
+    }
+    m_results.clear();
+
+    // Wanted chunks, nearest first
+    glm::vec2 p = glm::vec2(cameraPos.x, cameraPos.z);
+    glm::ivec2 center = Terrain::chunkAt(cameraPos.x, cameraPos.z);
+    int radius = (int)glm::ceil(viewDistance / Terrain::chunkSize);
+    std::vector<std::pair<float, glm::ivec2>> wanted;
+    for (int z = center.y - radius; z <= center.y + radius; z++) {
+        for (int x = center.x - radius; x <= center.x + radius; x++) {
+            float dist = chunkDistance(p, glm::ivec2(x, z));
+            if (dist <= viewDistance) {
+                wanted.push_back({dist, glm::ivec2(x, z)});
+            }
+        }
+    }
+    std::sort(wanted.begin(), wanted.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    if (wanted.size() > maxChunks) {
+        wanted.resize(maxChunks);
+    }
+
+    // Touch resident chunks so they stay in the cache, and queue the rest.
+    // Chunks built with an old parameter keep being drawn until replaced.
+    std::vector<glm::ivec2> missing;
+    for (auto it = wanted.rbegin(); it != wanted.rend(); it++) {
+        auto found = m_lookup.find(it->second);
+        if (found != m_lookup.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, found->second);
+        }
+    }
+    for (const auto &[dist, key] : wanted) {
+        auto found = m_lookup.find(key);
+        if (found == m_lookup.end() || found->second->param1 != param1) {
+            missing.push_back(key);
+        }
+    }
+    m_worker.request(missing, param1);
+
+    // Evict least recently used chunks over capacity, then any that are far away
+    while (m_lru.size() > maxChunks) {
+        evict(std::prev(m_lru.end()));
+    }
+    for (auto it = m_lru.begin(); it != m_lru.end();) {
+        auto next = std::next(it);
+        if (chunkDistance(p, it->key) > viewDistance + Terrain::chunkSize) {
+            evict(it);
+        }
+        it = next;
+    }
+}
+
+void TerrainChunks::upload(TerrainChunkResult &result) {
+    auto found = m_lookup.find(result.chunk);
+    if (found == m_lookup.end()) {
+        Chunk chunk;
+        chunk.key = result.chunk;
+        glGenVertexArrays(1, &chunk.vao);
+        glGenBuffers(1, &chunk.vbo);
+        glGenBuffers(1, &chunk.ebo);
+        m_lru.push_front(chunk);
+        found = m_lookup.emplace(result.chunk, m_lru.begin()).first;
+    }
+    else {
+        m_lru.splice(m_lru.begin(), m_lru, found->second);
+    }
+
+    Chunk &chunk = *found->second;
+    const TerrainMesh &mesh = result.mesh;
+    chunk.param1 = result.param1;
+    chunk.indexCount = mesh.indices.size();
+    chunk.boundsMin = mesh.boundsMin;
+    chunk.boundsMax = mesh.boundsMax;
+
+    // Vertex Array Objects
+    glBindVertexArray(chunk.vao);
+
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vbo);
+    glBufferData(GL_ARRAY_BUFFER, (sizeof(GLfloat) *
+                                   mesh.vertexData.size()),
+                 (mesh.vertexData.data()), GL_STATIC_DRAW);
+
+    // the element buffer binding is stored in the VAO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (sizeof(GLuint) *
+                                           mesh.indices.size()),
+                 (mesh.indices.data()), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+
+    // two sets of three floats, vertices, norms
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 24,
+                          reinterpret_cast<void*>(0));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 24,
+                          reinterpret_cast<void*>((3 * sizeof(GLfloat))));
+    // Returning to Default State
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void TerrainChunks::evict(std::list<Chunk>::iterator it) {
+    glDeleteVertexArrays(1, &it->vao);
+    glDeleteBuffers(1, &it->vbo);
+    glDeleteBuffers(1, &it->ebo);
+    m_lookup.erase(it->key);
+    m_lru.erase(it);
+}
+
+void TerrainChunks::draw(const glm::mat4 &viewProj) const {
+    for (const Chunk &chunk : m_lru) {
+        if (!inFrustum(viewProj, chunk.boundsMin, chunk.boundsMax)) {
+            continue;
+        }
+        glBindVertexArray(chunk.vao);
+        glDrawElements(GL_TRIANGLES, chunk.indexCount, GL_UNSIGNED_INT, nullptr);
+    }
+    glBindVertexArray(0);
+}
+
+void TerrainChunks::clear() {
+    while (!m_lru.empty()) {
+        evict(m_lru.begin());
+    }
+}
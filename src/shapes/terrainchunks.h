@@ -0,0 +1,63 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "terrainworker.h"
+
+// Streams terrain chunks around the camera. Chunks within the view distance
+// are generated on demand by a TerrainWorker and kept on the GPU in a bounded
+// LRU cache; far-away chunks are evicted. Each chunk is frustum-culled by its
+// AABB before drawing.
+class TerrainChunks
+{
+public:
+    // Most chunks resident on the GPU at once
+    static constexpr int maxChunks = 48;
+
+    // Collects finished chunks, requests missing ones and evicts old ones.
+    // Must be called with the GL context current.
+    void update(glm::vec3 cameraPos, float viewDistance, int param1);
+
+    // Draws the visible chunks with the currently bound shader
+    void draw(const glm::mat4 &viewProj) const;
+
+    // Frees all GL objects
+    void clear();
+
+private:
+    struct Chunk {
+        glm::ivec2 key;
+        int param1;
+        GLuint vao;
+        GLuint vbo;
+        GLuint ebo;
+        GLsizei indexCount;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    struct KeyHash {
+        size_t operator()(glm::ivec2 key) const {
+            return std::hash<long long>()(((long long)key.x << 32) ^ (unsigned int)key.y);
+        }
+    };
+
+    void upload(TerrainChunkResult &result);
+    void evict(std::list<Chunk>::iterator it);
+
+    // Front is most recently used
+    std::list<Chunk> m_lru;
+    std::unordered_map<glm::ivec2, std::list<Chunk>::iterator, KeyHash> m_lookup;
+    std::vector<TerrainChunkResult> m_results;
+
+    TerrainWorker m_worker;
+};
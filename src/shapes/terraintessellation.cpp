@@ -0,0 +1,109 @@
+#include "terraintessellation.h"
+
+#include <algorithm>
+
+#include "utils/shaderloader.h"
+
+// Side length and corner of the baked square, in world units
+static constexpr float regionSize = TerrainTessellation::regionChunks * Terrain::chunkSize;
+static const glm::vec2 regionOrigin = glm::vec2(-regionSize / 2.0f);
+
+// Target length of a tessellated triangle edge on screen, in pixels
+static constexpr float pixelsPerEdge = 12.0;
+
+void TerrainTessellation::initialize() {
+    m_program = ShaderLoader::createShaderProgram(
+                ":/resources/shaders/terrain.vert",
+                ":/resources/shaders/terrain.tesc",
+                ":/resources/shaders/terrain.tese",
+                ":/resources/shaders/default.frag");
+
+    // Four corners per patch, ordered (x0, z0), (x1, z0), (x1, z1), (x0, z1)
+    std::vector<GLfloat> data;
+    float patchSize = regionSize / patchesPerSide;
+    for (int z = 0; z < patchesPerSide; z++) {
+        for (int x = 0; x < patchesPerSide; x++) {
+            glm::vec2 lo = regionOrigin + patchSize * glm::vec2(x, z);
+            glm::vec2 hi = lo + patchSize;
+            data.insert(data.end(), {lo.x, lo.y, hi.x, lo.y, hi.x, hi.y, lo.x, hi.y});
+        }
+    }
+    m_numPatchVertices = data.size() / 2;
+
+    glGenBuffers(1, &m_patch_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_patch_vbo);
+    glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(GLfloat), data.data(), GL_STATIC_DRAW);
+    glGenVertexArrays(1, &m_patch_vao);
+    glBindVertexArray(m_patch_vao);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), nullptr);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenTextures(1, &m_heightmap);
+    glBindTexture(GL_TEXTURE_2D, m_heightmap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    m_bake = std::async(std::launch::async, [this] {
+        return m_terrain.bakeHeightmap(regionOrigin, regionSize, heightmapResolution);
+    });
+}
+
+void TerrainTessellation::finish() {
+    if (m_bake.valid()) {
+        m_bake.wait();
+    }
+    glDeleteProgram(m_program);
+    glDeleteVertexArrays(1, &m_patch_vao);
+    glDeleteBuffers(1, &m_patch_vbo);
+    glDeleteTextures(1, &m_heightmap);
+}
+
+void TerrainTessellation::update() {
+    if (m_baked || !m_bake.valid() ||
+            m_bake.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+
+    std::vector<float> heights = m_bake.get();
+    auto [lo, hi] = std::minmax_element(heights.begin(), heights.end());
+    m_heightRange = glm::vec2(*lo, *hi);
+
+    glBindTexture(GL_TEXTURE_2D, m_heightmap);
+    glTexImage2D(GL_TEXTURE_2D,
+                 0, // level
+                 GL_R32F, // internalformat
+                 heightmapResolution,
+                 heightmapResolution,
+                 0, // border
+                 GL_RED, // format
+                 GL_FLOAT,
+                 heights.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_baked = true;
+}
+
+void TerrainTessellation::draw(float lodScale) const {
+    if (!m_baked) {
+        return;
+    }
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, m_heightmap);
+    glUniform1i(glGetUniformLocation(m_program, "heightmap"), 0);
+    glUniform2fv(glGetUniformLocation(m_program, "heightmapOrigin"), 1, &regionOrigin[0]);
+    glUniform1f(glGetUniformLocation(m_program, "heightmapSize"), regionSize);
+    glUniform2fv(glGetUniformLocation(m_program, "heightRange"), 1, &m_heightRange[0]);
+    glUniform1f(glGetUniformLocation(m_program, "lodScale"), lodScale);
+    glUniform1f(glGetUniformLocation(m_program, "pixelsPerEdge"), pixelsPerEdge);
+
+    glPatchParameteri(GL_PATCH_VERTICES, 4);
+    glBindVertexArray(m_patch_vao);
+    glDrawArrays(GL_PATCHES, 0, m_numPatchVertices);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
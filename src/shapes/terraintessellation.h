@@ -0,0 +1,55 @@
+#pragma once
+
+// Defined before including GLEW to suppress deprecation messages on macOS
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <future>
+#include <vector>
+
+#include "Terrain.h"
+
+// GPU-displaced terrain. The heightfield is baked once into a 2D float
+// texture covering a fixed square around the origin. A coarse grid of quad
+// patches is then tessellated on the GPU, with each edge's level chosen from
+// its approximate size on screen, and displaced by the texture.
+class TerrainTessellation
+{
+public:
+    static constexpr int regionChunks = 4;          // baked area, in chunks per side
+    static constexpr int heightmapResolution = 512; // texels per side
+    static constexpr int patchesPerSide = 32;
+
+    // Creates the shader and patch grid, and starts baking the heightmap on a
+    // background thread. Must be called with the GL context current.
+    void initialize();
+    void finish();
+
+    // Uploads the heightmap once baking has finished.
+    void update();
+
+    // Program to set the lighting uniforms on before calling draw()
+    GLuint program() const { return m_program; }
+
+    // Draws the patches with program(), which must be bound.
+    // lodScale is the on-screen size, in pixels, of one world unit at unit
+    // distance from the camera.
+    void draw(float lodScale) const;
+
+private:
+    GLuint m_program = 0;
+    GLuint m_patch_vbo = 0;
+    GLuint m_patch_vao = 0;
+    GLuint m_heightmap = 0;
+    GLsizei m_numPatchVertices = 0;
+
+    bool m_baked = false;
+    glm::vec2 m_heightRange = glm::vec2(0);
+    std::future<std::vector<float>> m_bake;
+
+    // Only touched by the baking thread
+    Terrain m_terrain;
+};
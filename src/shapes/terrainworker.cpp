@@ -0,0 +1,92 @@
+#include "terrainworker.h"
+
+#include <algorithm>
+
+TerrainWorker::TerrainWorker()
+    : m_thread([this](std::stop_token stop) { run(stop); }) {}
+
+TerrainWorker::~TerrainWorker() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Abandon any mesh in progress; m_thread is stopped and joined on destruction
+    m_queue.clear();
+    m_activeStop.request_stop();
+}
+
+/**
+ * @brief TerrainWorker::request - replaces the queue of chunks to generate.
+ * @param chunks - the wanted chunks, in the order they should be generated
+ * @param param1 - tesselation parameter for all of them
+ * The chunk in flight, if any, is cancelled unless it is still wanted.
+ * Chunks whose result is already waiting to be taken are skipped.
+ */
+void TerrainWorker::request(const std::vector<glm::ivec2> &chunks, int param1) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    bool activeWanted = false;
+    m_queue.clear();
+    m_queueParam1 = param1;
+    for (glm::ivec2 chunk : chunks) {
+        if (m_busy && chunk == m_activeChunk && param1 == m_activeParam1) {
+            activeWanted = true;
+            continue;
+        }
+        if (!hasResult(chunk, param1)) {
+            m_queue.push_back(chunk);
+        }
+    }
+
+    if (m_busy && !activeWanted) {
+        m_activeStop.request_stop();
+    }
+    m_cv.notify_one();
+}
+
+/**
+ * @brief TerrainWorker::takeResults - appends all finished meshes to results.
+ */
+void TerrainWorker::takeResults(std::vector<TerrainChunkResult> &results) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (TerrainChunkResult &result : m_results) {
+        results.push_back(std::move(result));
+    }
+    m_results.clear();
+}
+
+bool TerrainWorker::hasResult(glm::ivec2 chunk, int param1) const {
+    return std::any_of(m_results.begin(), m_results.end(),
+                       [&](const TerrainChunkResult &result) {
+        return result.chunk == chunk && result.param1 == param1;
+    });
+}
+
+void TerrainWorker::run(std::stop_token threadStop) {
+    while (true) {
+        glm::ivec2 chunk;
+        int param1;
+        std::stop_token jobStop;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!m_cv.wait(lock, threadStop, [this] { return !m_queue.empty(); })) {
+                return;
+            }
+            chunk = m_queue.front();
+            param1 = m_queueParam1;
+            m_queue.pop_front();
+
+            m_busy = true;
+            m_activeChunk = chunk;
+            m_activeParam1 = param1;
+            m_activeStop = std::stop_source();
+            jobStop = m_activeStop.get_token();
+        }
+
+        TerrainMesh mesh = m_terrain.generateChunk(param1, chunk, jobStop);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_busy = false;
+        // The chunk may have been cancelled while the lock was released
+        if (!jobStop.stop_requested()) {
+            m_results.push_back({chunk, param1, std::move(mesh)});
+        }
+    }
+}
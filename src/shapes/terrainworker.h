@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+#include "Terrain.h"
+
+struct TerrainChunkResult {
+    glm::ivec2 chunk;
+    int param1;
+    TerrainMesh mesh;
+};
+
+// Generates terrain chunk meshes on a background thread so that the GUI
+// thread never waits on noise evaluation. Each request replaces the queue of
+// wanted chunks; a chunk in flight that is no longer wanted is cancelled.
+// Finished meshes are picked up from the GL thread with takeResults().
+class TerrainWorker
+{
+public:
+    TerrainWorker();
+    ~TerrainWorker();
+
+    void request(const std::vector<glm::ivec2> &chunks, int param1);
+    void takeResults(std::vector<TerrainChunkResult> &results);
+
+private:
+    void run(std::stop_token threadStop);
+    bool hasResult(glm::ivec2 chunk, int param1) const;
+
+    std::mutex m_mutex;
+    std::condition_variable_any m_cv;
+    std::deque<glm::ivec2> m_queue;
+    int m_queueParam1 = 0;
+
+    bool m_busy = false;
+    glm::ivec2 m_activeChunk;
+    int m_activeParam1 = 0;
+    std::stop_source m_activeStop;
+
+    std::vector<TerrainChunkResult> m_results;
+
+    // Only touched by the worker thread
+    Terrain m_terrain;
+
+    // Declared last so the thread is joined before the state above is destroyed
+    std::jthread m_thread;
+};
@@ -7,7 +7,12 @@
 #include <GL/glew.h>
 #include <QFile>
 #include <QTextStream>
+#include <algorithm>
+#include <initializer_list>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
 
 class ShaderLoader{
 public:
@@ -16,10 +21,30 @@ public:
         GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertex_file_path);
         GLuint fragmentShaderID = createShader(GL_FRAGMENT_SHADER, fragment_file_path);
 
+        return linkProgram({vertexShaderID, fragmentShaderID});
+    }
+
+    // Same as above, with tessellation control and evaluation stages.
+    static GLuint createShaderProgram(const char * vertex_file_path,
+                                      const char * tess_control_file_path,
+                                      const char * tess_evaluation_file_path,
+                                      const char * fragment_file_path){
+        GLuint vertexShaderID = createShader(GL_VERTEX_SHADER, vertex_file_path);
+        GLuint tessControlShaderID = createShader(GL_TESS_CONTROL_SHADER, tess_control_file_path);
+        GLuint tessEvaluationShaderID = createShader(GL_TESS_EVALUATION_SHADER, tess_evaluation_file_path);
+        GLuint fragmentShaderID = createShader(GL_FRAGMENT_SHADER, fragment_file_path);
+
+        return linkProgram({vertexShaderID, tessControlShaderID,
+                            tessEvaluationShaderID, fragmentShaderID});
+    }
+
+private:
+    static GLuint linkProgram(std::initializer_list<GLuint> shaderIDs){
         // Link the shader program.
         GLuint programID = glCreateProgram();
-        glAttachShader(programID, vertexShaderID);
-        glAttachShader(programID, fragmentShaderID);
+        for (GLuint shaderID : shaderIDs) {
+            glAttachShader(programID, shaderID);
+        }
         glLinkProgram(programID);
 
         // Print the info log if error
@@ -38,26 +63,80 @@ public:
         }
 
         // Shaders no longer necessary, stored in program
-        glDeleteShader(vertexShaderID);
-        glDeleteShader(fragmentShaderID);
+        for (GLuint shaderID : shaderIDs) {
+            glDeleteShader(shaderID);
+        }
 
         return programID;
     }
 
-private:
-    static GLuint createShader(GLenum shaderType, const char *filepath){
-        GLuint shaderID = glCreateShader(shaderType);
+    // Reads a shader file, replacing each line #include "name" with the
+    // contents of the file name, found next to it. #line directives keep the
+    // compiler's errors pointing into the right file: source string 0 is the
+    // shader itself, and included files are numbered from 1 in the order
+    // they appear. A file already included is skipped the second time, so
+    // its definitions are not repeated; a file that includes itself,
+    // directly or not, is an error. expanding holds the files being read,
+    // outermost first, and included every file read so far.
+    static std::string readShader(const std::string &filepath, int source, int &numSources,
+                                  std::vector<std::string> &expanding,
+                                  std::vector<std::string> &included){
+        expanding.push_back(filepath);
+        included.push_back(filepath);
 
-        // Read shader file.
         std::string code;
-        QString filepathStr = QString(filepath);
+        QString filepathStr = QString(filepath.c_str());
         QFile file(filepathStr);
         if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
             QTextStream stream(&file);
             code = stream.readAll().toStdString();
         }else{
-            throw std::runtime_error(std::string("Failed to open shader: ")+filepath);
+            throw std::runtime_error("Failed to open shader: " + filepath);
+        }
+
+        const std::string include = "#include \"";
+        std::string directory = filepath.substr(0, filepath.rfind('/') + 1);
+        std::istringstream lines(code);
+        std::string expanded, line;
+        for (int number = 1; std::getline(lines, line); number++) {
+            if (line.compare(0, include.size(), include) != 0) {
+                expanded += line + '\n';
+                continue;
+            }
+            size_t end = line.find('"', include.size());
+            if (end == std::string::npos) {
+                throw std::runtime_error("Unterminated #include in shader: " + filepath
+                                         + ":" + std::to_string(number));
+            }
+            std::string name = directory + line.substr(include.size(), end - include.size());
+            if (std::find(expanding.begin(), expanding.end(), name) != expanding.end()) {
+                std::string cycle;
+                for (const std::string &file : expanding) {
+                    cycle += file + " -> ";
+                }
+                throw std::runtime_error("#include cycle in shader: " + cycle + name);
+            }
+            if (std::find(included.begin(), included.end(), name) != included.end()) {
+                expanded += '\n';
+                continue;
+            }
+            int includedSource = numSources++;
+            expanded += "#line 1 " + std::to_string(includedSource) + '\n';
+            expanded += readShader(name, includedSource, numSources, expanding, included);
+            expanded += "#line " + std::to_string(number + 1) + ' '
+                    + std::to_string(source) + '\n';
         }
+        expanding.pop_back();
+        return expanded;
+    }
+
+    static GLuint createShader(GLenum shaderType, const char *filepath){
+        GLuint shaderID = glCreateShader(shaderType);
+
+        // Read shader file, with the files it includes.
+        int numSources = 1;
+        std::vector<std::string> expanding, included;
+        std::string code = readShader(filepath, 0, numSources, expanding, included);
 
         // Compile shader code.
         const char *codePtr = code.c_str();